@@ -1,4 +1,5 @@
 #include <cassert>
+#include <cstring>
 #include <caffe/caffe.hpp>
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
@@ -23,6 +24,12 @@ BBox::BBox(const Rect &rect) {
   this->rect = rect;
 }
 
+BBox::BBox(BBox const &other) {
+  this->x = other.x; this->y = other.y;
+  this->width = other.width; this->height = other.height;
+  this->rect = other.rect;
+}
+
 void BBox::Project(const vector<Point2f> &absLandmark, vector<Point2f> &relLandmark) const {
   assert(absLandmark.size() == relLandmark.size());
   for (int i = 0; i < absLandmark.size(); i++) {
@@ -101,26 +108,6 @@ int FaceDetector::DetectFace(const Mat &img, vector<Rect> &rects) {
   return rects.size();
 }
 
-void Landmarker::LoadModel(const string &path) {
-  string network = path + "/1_F.prototxt";
-  string model = path + "/1_F.caffemodel";
-  F = new CNN(network, model);
-  string networks[10] = { "/2_LE1.prototxt", "/2_LE2.prototxt", "/2_RE1.prototxt", "/2_RE2.prototxt", \
-                          "/2_N1.prototxt", "/2_N2.prototxt", "/2_LM1.prototxt", "/2_LM2.prototxt", \
-                          "/2_RM1.prototxt", "/2_RM2.prototxt" };
-  string models[10] = { "/2_LE1.caffemodel", "/2_LE2.caffemodel", "/2_RE1.caffemodel", "/2_RE2.caffemodel", \
-                        "/2_N1.caffemodel", "/2_N2.caffemodel", "/2_LM1.caffemodel", "/2_LM2.caffemodel", \
-                        "/2_RM1.caffemodel", "/2_RM2.caffemodel" };
-  for (int i = 0; i < 5; i++) {
-    network = path + networks[2 * i];
-    model = path + models[2 * i];
-    level2[2 * i] = new CNN(network, model);
-    network = path + networks[2 * i + 1];
-    model = path + models[2 * i + 1];
-    level2[2 * i + 1] = new CNN(network, model);
-  }
-}
-
 Mat GetPatch(const Mat &img, const BBox &bbox, const Point2f &point, \
                          double padding, BBox& patch_bbox) {
   double x = bbox.x + point.x*bbox.width;
@@ -146,34 +133,81 @@ Mat process(const Mat &img, Size size) {
   return data;
 }
 
-vector<Point2f> Landmarker::DetectLandmark(const Mat &img, const BBox &bbox){
-  assert(img.type() == CV_8UC1);
-  Mat data = process(img(bbox.rect), Size(39, 39));
-  // level 1
-  vector<Point2f> landmarks = F->forward(data, "fc2");
-  // level 2
+static void FillInput(const Mat &data, Blob *input, int item) {
+  float *blob_data = input->mutable_cpu_data() + input->offset(item);
+  for (int i = 0; i < data.rows; i++) {
+    memcpy(blob_data + i*data.cols, data.ptr<float>(i), data.cols*sizeof(float));
+  }
+}
+
+void Landmarker::LoadModel(const string &path) {
+  string network = path + "/1_F.prototxt";
+  string model = path + "/1_F.caffemodel";
+  F = new CNN(network, model);
+  string networks[10] = { "/2_LE1.prototxt", "/2_LE2.prototxt", "/2_RE1.prototxt", "/2_RE2.prototxt", \
+                          "/2_N1.prototxt", "/2_N2.prototxt", "/2_LM1.prototxt", "/2_LM2.prototxt", \
+                          "/2_RM1.prototxt", "/2_RM2.prototxt" };
+  string models[10] = { "/2_LE1.caffemodel", "/2_LE2.caffemodel", "/2_RE1.caffemodel", "/2_RE2.caffemodel", \
+                        "/2_N1.caffemodel", "/2_N2.caffemodel", "/2_LM1.caffemodel", "/2_LM2.caffemodel", \
+                        "/2_RM1.caffemodel", "/2_RM2.caffemodel" };
   for (int i = 0; i < 5; i++) {
-    Point2f point = landmarks[i];
-    BBox patch_bbox(0, 0, 0, 0);
-
-    Mat roi = GetPatch(img, bbox, point, 0.16, patch_bbox);
-    data = process(roi, Size(15, 15));
-    CNN *net = level2[2 * i];
-    vector<Point2f> res = net->forward(data, "fc2");
-    patch_bbox.ReProject(res, res);
-    bbox.Project(res, res);
-    Point2f p1 = res[0];
-
-    roi = GetPatch(img, bbox, point, 0.18, patch_bbox);
-    data = process(roi, Size(15, 15));
-    net = level2[2 * i + 1];
-    res = net->forward(data, "fc2");
-    patch_bbox.ReProject(res, res);
-    bbox.Project(res, res);
-    Point2f p2 = res[0];
-
-    landmarks[i] = Point2f((p1.x + p2.x) / 2., (p1.y + p2.y) / 2.);
+    network = path + networks[2 * i];
+    model = path + models[2 * i];
+    level2[2 * i] = new CNN(network, model);
+    network = path + networks[2 * i + 1];
+    model = path + models[2 * i + 1];
+    level2[2 * i + 1] = new CNN(network, model);
+  }
+  // level 1, the face of every item
+  cascade.AddStage(vector<Net*>(1, F->cnn), "fc2", [this](int net, int item, Blob *input) {
+    const BBox &bbox = (*bboxes_)[item];
+    FillInput(process((*img_)(bbox.rect), Size(39, 39)), input, item);
+  });
+  // level 2, net 2i and 2i+1 refine landmark i from patches of two sizes
+  vector<Net*> nets(10);
+  for (int i = 0; i < 10; i++) {
+    nets[i] = level2[i]->cnn;
+  }
+  cascade.AddStage(nets, "fc2", [this](int net, int item, Blob *input) {
+    const BBox &bbox = (*bboxes_)[item];
+    const float *landmarks = cascade.output(0, 0, item);
+    const int i = net / 2;
+    Point2f point(landmarks[2 * i], landmarks[2 * i + 1]);
+    double padding = (net % 2 == 0) ? 0.16 : 0.18;
+    Mat roi = GetPatch(*img_, bbox, point, padding, patch_bboxes_[10 * item + net]);
+    FillInput(process(roi, Size(15, 15)), input, item);
+  });
+}
+
+vector<Point2f> Landmarker::DetectLandmark(const Mat &img, const BBox &bbox) {
+  return DetectLandmarks(img, vector<BBox>(1, bbox))[0];
+}
+
+vector<vector<Point2f> > Landmarker::DetectLandmarks(const Mat &img, const vector<BBox> &bboxes) {
+  assert(img.type() == CV_8UC1);
+  vector<vector<Point2f> > result(bboxes.size());
+  if (bboxes.empty()) return result;
+  img_ = &img;
+  bboxes_ = &bboxes;
+  patch_bboxes_.assign(10 * bboxes.size(), BBox(0, 0, 0, 0));
+  cascade.Run(bboxes.size());
+  for (int f = 0; f < bboxes.size(); f++) {
+    const BBox &bbox = bboxes[f];
+    vector<Point2f> &landmarks = result[f];
+    landmarks.resize(5);
+    for (int i = 0; i < 5; i++) {
+      Point2f p[2];
+      for (int k = 0; k < 2; k++) {
+        const int net = 2 * i + k;
+        const float *out = cascade.output(1, net, f);
+        vector<Point2f> res(1, Point2f(out[0], out[1]));
+        patch_bboxes_[10 * f + net].ReProject(res, res);
+        bbox.Project(res, res);
+        p[k] = res[0];
+      }
+      landmarks[i] = Point2f((p[0].x + p[1].x) / 2., (p[0].y + p[1].y) / 2.);
+    }
+    bbox.ReProject(landmarks, landmarks);
   }
-  bbox.ReProject(landmarks, landmarks);
-  return landmarks;
+  return result;
 }
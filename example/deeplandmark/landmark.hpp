@@ -38,9 +38,16 @@ struct CNN {
 struct Landmarker {
   CNN *F;
   CNN *level2[10];
+  // level 1 over all faces, then the 10 level 2 nets over patches around
+  // the level 1 landmarks, one forward per net for all faces
+  caffe::Cascade cascade;
+  const cv::Mat *img_;
+  const std::vector<BBox> *bboxes_;
+  std::vector<BBox> patch_bboxes_;
 
   void LoadModel(const std::string &path);
   std::vector<cv::Point2f> DetectLandmark(const cv::Mat &img, const BBox &bbox);
+  std::vector<std::vector<cv::Point2f> > DetectLandmarks(const cv::Mat &img, const std::vector<BBox> &bboxes);
 };
 
 #endif // __EX_HPP__
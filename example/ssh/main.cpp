@@ -54,18 +54,10 @@ vector<int> NonMaximumSuppression(const vector<BBox>& bboxes,
 
 std::vector<BBox> ForwardNet(Net& net, const Mat& img, float scale_factor, bool keep_m3=true, float th = 0.3f) {
   // prepare input data
-  vector<Mat> bgr;
-  cv::split(img, bgr);
-  bgr[0].convertTo(bgr[0], CV_32F, 1.f, -102.9801f);
-  bgr[1].convertTo(bgr[1], CV_32F, 1.f, -115.9465f);
-  bgr[2].convertTo(bgr[2], CV_32F, 1.f, -122.7717f);
+  const float kMean[] = { 102.9801f, 115.9465f, 122.7717f };
   shared_ptr<Blob> data = net.blob_by_name("data");
   data->Reshape(1, 3, img.rows, img.cols);
-  const int bias = data->offset(0, 1, 0, 0);
-  const int bytes = bias*sizeof(float);
-  memcpy(data->mutable_cpu_data() + 0 * bias, bgr[0].data, bytes);
-  memcpy(data->mutable_cpu_data() + 1 * bias, bgr[1].data, bytes);
-  memcpy(data->mutable_cpu_data() + 2 * bias, bgr[2].data, bytes);
+  data->SetImage(0, img.data, img.rows, img.cols, 3, kMean);
   shared_ptr<Blob> im_info = net.blob_by_name("im_info");
   im_info->mutable_cpu_data()[0] = img.rows;
   im_info->mutable_cpu_data()[1] = img.cols;
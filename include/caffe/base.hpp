@@ -1,6 +1,7 @@
 #ifndef CAFFE_BASE_HPP_
 #define CAFFE_BASE_HPP_
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <memory>
@@ -66,16 +67,56 @@ CAFFE_API void SetMode(DeviceMode mode, int device);
 //// ThreadLocal Memory Pool API
 
 struct MemPoolState {
-  int gpu_mem;  // gpu memory, calculate on all device memory used by this thread
-  int cpu_mem;  // cpu memory
-  int unused_gpu_mem;  // not used gpu memory
-  int unused_cpu_mem;  // not used cpu memory
+  int64_t gpu_mem;  // gpu memory, calculate on all device memory used by this thread
+  int64_t cpu_mem;  // cpu memory
+  int64_t unused_gpu_mem;  // not used gpu memory
+  int64_t unused_cpu_mem;  // not used cpu memory
 };
 /*! \brief get memory usage in current thread */
 CAFFE_API MemPoolState MemPoolGetState();
 /*! \brief clear unused memory pool in current thread */
 CAFFE_API void MemPoolClear();
 
+/*!
+ * \brief memory arena, network weights and activations are pooled separately
+ *  so long living weights are packed together and can use their own policy
+ */
+enum MemArena {
+  kActivationArena = 0,
+  kWeightArena = 1,
+};
+/*! \brief cpu allocation policy of a memory arena */
+struct MemPoolPolicy {
+  int alignment;  // byte alignment of memory block, power of 2, default 64
+  size_t huge_page_threshold;  // back blocks >= this size by 2 MB huge pages, 0 disables
+  bool use_hugetlbfs;  // try explicit huge pages (MAP_HUGETLB) before transparent huge pages
+};
+/*!
+ * \brief set allocation policy of an arena, takes effect in current thread
+ *  and threads which create their memory pool afterwards
+ */
+CAFFE_API void MemPoolSetPolicy(MemArena arena, const MemPoolPolicy& policy);
+/*! \brief get allocation policy of an arena in current thread */
+CAFFE_API MemPoolPolicy MemPoolGetPolicy(MemArena arena);
+/*!
+ * \brief limit unused cpu memory held by memory pool, least recently returned
+ *  blocks are freed once the limit is exceeded, negative for no limit (default)
+ *  takes effect in current thread and threads which create their memory pool afterwards
+ *  with MemPoolUseGlobal the limit is the size of the thread cache instead, blocks
+ *  over it are passed to the central free lists and not freed
+ */
+CAFFE_API void MemPoolSetRetainLimit(int64_t bytes);
+/*!
+ * \brief share unused cpu memory of all threads through a process wide pool,
+ *  every thread caches at most thread_cache bytes and passes the rest, and all
+ *  of it when the thread exits, to central free lists used by every thread.
+ *  call it before any network is created, MemPoolGetState then reports the
+ *  whole process and MemPoolClear frees the central free lists too.
+ *  thread_cache is set as the retain limit, calling MemPoolSetRetainLimit
+ *  afterwards changes the thread cache size
+ */
+CAFFE_API void MemPoolUseGlobal(int64_t thread_cache);
+
 }  // namespace caffe
 
 #endif  // CAFFE_COMMON_HPP_
@@ -25,7 +25,7 @@ class SyncedMemory;
 class CAFFE_API Blob {
  public:
   Blob()
-      : data_(), count_(0), capacity_(0) {}
+      : data_(), count_(0), capacity_(0), offset_(0) {}
 
   /// @brief Deprecated; use <code>Blob(const vector<int>& shape)</code>.
   explicit Blob(const int num, const int channels,
@@ -74,6 +74,8 @@ class CAFFE_API Blob {
   }
   int num_axes() const { return static_cast<int>(shape_.size()); }
   int count() const { return count_; }
+  /// @brief number of elements the data can hold without reallocation
+  int capacity() const { return capacity_; }
 
   /**
    * @brief Compute the volume of a slice; i.e., the product of dimensions
@@ -194,6 +196,29 @@ class CAFFE_API Blob {
   real_t* mutable_cpu_data();
   real_t* mutable_gpu_data();
 
+  /**
+   * @brief Use memory owned by the caller as data of this Blob, no copy is
+   *        made. The memory must hold count() elements and stay valid while
+   *        it is bound. Reshaping to a larger count afterwards is an error,
+   *        bind a larger buffer instead.
+   */
+  void set_cpu_data(real_t* data);
+  /// @brief whether data of this Blob is owned by the caller
+  bool external_data() const;
+
+  /**
+   * @brief Fill item n of a (N x C x H x W) Blob from an interleaved 8-bit
+   *        image of H x W x C pixels, as (pixel - mean[c]) * scale, in one
+   *        pass over the image.
+   *
+   * Channel c of the Blob reads channel channel_order[c] of the image, so
+   * {2, 1, 0} turns BGR into RGB. mean holds C values in Blob channel order,
+   * NULL subtracts nothing, and NULL channel_order keeps the image order.
+   */
+  void SetImage(int n, const unsigned char* image, int height, int width,
+                int channels, const real_t* mean = NULL, real_t scale = 1,
+                const int* channel_order = NULL);
+
   void FromProto(const BlobProto& proto, bool reshape = true);
   void ToProto(BlobProto* proto) const;
 
@@ -206,6 +231,15 @@ class CAFFE_API Blob {
    * shared_ptr calls its destructor when reset with the "=" operator.
    */
   void ShareData(const Blob& other);
+  /**
+   * @brief Make this Blob a view of the data_ of Blob other, starting at
+   *        element offset. This Blob must be shaped and fit in other.
+   *
+   * Layers write such a view in place of a part of other, e.g. a channel
+   * range of a Concat output. Reshaping the view to a larger count gives it
+   * memory of its own again.
+   */
+  void ShareData(const Blob& other, int offset);
 
   /*! \brief release memory */
   void Release();
@@ -218,6 +252,7 @@ class CAFFE_API Blob {
   vector<int> shape_;
   int count_;
   int capacity_;
+  int offset_;  // element offset of a view into shared data_
 
   DISABLE_COPY_AND_ASSIGN(Blob);
 };  // class Blob
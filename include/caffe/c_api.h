@@ -36,11 +36,39 @@ CAFFE_API real_t *CaffeBlobData(BlobHandle blob);
 CAFFE_API int CaffeBlobCount(BlobHandle blob);
 /*!
  * \brief reshape blob
- * \note  this may change blob data pointer
+ * \note  this may change blob data pointer, a blob bound to external data
+ *  keeps the binding while the bound buffer holds the new count, otherwise
+ *  the binding is dropped
  */
 CAFFE_API int CaffeBlobReshape(BlobHandle blob, int shape_size, int* shape);
 /*! \brief get blob shape */
 CAFFE_API int CaffeBlobShape(BlobHandle blob, int* shape_size, int** shape);
+/*!
+ * \brief use memory owned by the caller as blob data without copy
+ * \param blob blob handle, usually network input or output
+ * \param data buffer holds CaffeBlobCount(blob) elements, it must stay valid
+ *  while bound and is never freed by the blob
+ * \note  reshape the blob before binding and bind again after the shape
+ *  grows. Blobs of a network are better bound by CaffeNetSetExternalData,
+ *  which also keeps an internal blob alive until forward ends
+ */
+CAFFE_API int CaffeBlobSetExternalData(BlobHandle blob, real_t *data);
+/*!
+ * \brief fill item n of a blob from an interleaved 8-bit image as
+ *  (pixel - mean[c]) * scale in one pass
+ * \param blob blob handle shaped (N, channels, height, width)
+ * \param n item of the batch to fill
+ * \param image height x width x channels pixels
+ * \param mean channels values in blob channel order, NULL for none
+ * \param scale multiplier applied after the mean is subtracted
+ * \param channel_order blob channel c reads image channel channel_order[c],
+ *  NULL keeps the image order
+ */
+CAFFE_API int CaffeBlobSetImage(BlobHandle blob, int n,
+                                const unsigned char *image,
+                                int height, int width, int channels,
+                                const real_t *mean, real_t scale,
+                                const int *channel_order);
 
 // Net API
 
@@ -74,11 +102,73 @@ CAFFE_API int CaffeNetDestroy(NetHandle net);
  * \param name blob name
  */
 CAFFE_API int CaffeNetMarkOutput(NetHandle net, const char *name);
+/*!
+ * \brief use memory owned by the caller as data of a network blob without
+ *  copy, the blob is kept alive until forward ends like a marked output
+ * \param net net handle
+ * \param name blob name, usually network input or output
+ * \param data buffer holds CaffeBlobCount of the blob elements, it must stay
+ *  valid while bound and is never freed by the network
+ * \note  reshape the blob before binding and bind again after the shape grows,
+ *  outputs of layers sharing their input, like Flatten, Reshape and Split,
+ *  are copied into the buffer
+ */
+CAFFE_API int CaffeNetSetExternalData(NetHandle net, const char *name,
+                                      real_t *data);
+/*!
+ * \brief only compute the named blobs, layers they do not depend on are
+ *  skipped by forward
+ * \param net net handle
+ * \param n number of blobs, 0 to run every layer again
+ * \param names blob names
+ */
+CAFFE_API int CaffeNetSetOutputs(NetHandle net, int n, const char **names);
 /*!
  * \brief forward network
  * \note  fill network input blobs before calling this function
  */
 CAFFE_API int CaffeNetForward(NetHandle net);
+/*!
+ * \brief fill item n of a network input from an interleaved 8-bit image
+ * \param net net handle
+ * \param name input blob name
+ * \param n item of the batch to fill
+ * \param image height x width x channels pixels
+ * \note  mean_value, scale and channel_swap come from the transform_param of
+ *  the Input layer, the blob is reshaped to the image keeping its num
+ */
+CAFFE_API int CaffeNetSetInputImage(NetHandle net, const char *name, int n,
+                                    const unsigned char *image,
+                                    int height, int width, int channels);
+/*!
+ * \brief fill inputs, forward network and copy outputs in one call
+ * \param net net handle
+ * \param n_input number of inputs
+ * \param inputs input blob handles, look them up once by CaffeNetGetBlob
+ * \param input_ndims number of dims of every input shape, NULL or 0 for
+ *  keeping the current shape of the input
+ * \param input_shapes shape of every input
+ * \param input_data data of every input, it holds count of the shape
+ * \param n_output number of outputs
+ * \param outputs output blob handles, look them up once by CaffeNetGetBlob
+ * \param output_capacity number of elements every output buffer can hold
+ * \param output_data buffers to copy outputs into, query output shapes by
+ *  CaffeBlobShape after the call
+ * \return return code, 0 for success, -1 for failed
+ * \note  inputs and outputs bound by CaffeBlobSetExternalData are not copied,
+ *  internal blobs are released during forward, mark them by
+ *  CaffeNetMarkOutput before asking for them, or the call fails
+ */
+CAFFE_API int CaffeNetRun(NetHandle net,
+                          int n_input,
+                          const BlobHandle *inputs,
+                          const int *input_ndims,
+                          const int *const *input_shapes,
+                          const real_t *const *input_data,
+                          int n_output,
+                          const BlobHandle *outputs,
+                          const int *output_capacity,
+                          real_t *const *output_data);
 /*!
  * \brief get network internal blob by name
  * \param net NetHandle
@@ -113,6 +203,39 @@ CAFFE_API int CaffeNetListParam(NetHandle net,
                                 const char ***names,
                                 BlobHandle **params);
 
+// Detection API
+
+/*!
+ * \brief turn rois and class scores of a detector into final detections, the
+ *  same post processing as the DetectionOutput layer
+ * \param rois blob of rois (R, 5) as (batch index, x1, y1, x2, y2)
+ * \param scores blob of class scores (R, C)
+ * \param im_info blob of image (height, width, scale), boxes are clipped to
+ *  the image and divided by scale, NULL to keep boxes as they are
+ * \param deltas blob of box deltas (R, 4), (R, 8) or (R, 4C), NULL if rois
+ *  are the final boxes, im_info is required with deltas
+ * \param background_label class of scores to skip, -1 if every class is an
+ *  object
+ * \param confidence_threshold scores at most this are dropped before sorting
+ * \param nms_threshold overlap above which NMS drops the lower scored box
+ * \param top_k best detections per class going through NMS, 0 for all
+ * \param keep_top_k best detections kept per image, 0 for all
+ * \param n number of detections
+ * \param detections n x 7 values as (batch index, label, score, x1, y1, x2,
+ *  y2), valid until the next call in this thread
+ */
+CAFFE_API int CaffeDetectionOutput(BlobHandle rois,
+                                   BlobHandle scores,
+                                   BlobHandle im_info,
+                                   BlobHandle deltas,
+                                   int background_label,
+                                   real_t confidence_threshold,
+                                   real_t nms_threshold,
+                                   int top_k,
+                                   int keep_top_k,
+                                   int *n,
+                                   const real_t **detections);
+
 // Profiler, don't enable Profiler in multi-thread Env
 
 /*!
@@ -9,5 +9,6 @@
 #include "caffe/blob.hpp"
 #include "caffe/net.hpp"
 #include "caffe/profiler.hpp"
+#include "caffe/cascade.hpp"
 
 #endif  // CAFFE_CAFFE_HPP_
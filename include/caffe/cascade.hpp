@@ -0,0 +1,84 @@
+#ifndef CAFFE_CASCADE_HPP_
+#define CAFFE_CASCADE_HPP_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "caffe/net.hpp"
+
+namespace caffe {
+
+/*!
+ * \brief Cascade runs chains of small Nets over many items, like the level 1
+ *  and level 2 Nets of a landmark model over all faces of an image.
+ *
+ * ```
+ * Cascade cascade;
+ * cascade.AddStage({ level1 }, "fc2", fill_face);
+ * cascade.AddStage(level2, "fc2", [&](int net, int item, Blob* input) {
+ *   const real_t* landmarks = cascade.output(0, 0, item);
+ *   ...  // crop around the landmarks of the face into item of input
+ * });
+ * cascade.Run(num_faces);
+ * ```
+ *
+ * A stage holds Nets that only read outputs of earlier stages. Every Net
+ * runs one Forward per Run with all items in one batch, so a stage of ten
+ * Nets over eight faces costs ten Forwards instead of eighty. The outputs of
+ * a stage stay in the Net and are read in place by the feeders of later
+ * stages. Nets of a stage run one after another on the calling thread, the
+ * memory pool and the mode are per thread.
+ */
+class CAFFE_API Cascade {
+ public:
+  /*!
+   * \brief fill item `item` of the input blob of Net `net` in a stage, the
+   *  blob is already reshaped with one item per Run item
+   */
+  typedef std::function<void(int net, int item, Blob* input)> Feeder;
+
+  /*!
+   * \brief append a stage, Nets are not owned and must outlive the Cascade
+   * \param nets Nets of the stage, the first input of each is fed
+   * \param output name of the output blob of every Net, kept by Forward
+   * \param feeder fill the inputs of every Net and item
+   * \return index of the stage
+   */
+  int AddStage(const std::vector<Net*>& nets, const std::string& output,
+               const Feeder& feeder);
+  /*!
+   * \brief run every stage over `num_items` items
+   * \param num_items batch size of every Net, must be > 0
+   */
+  void Run(int num_items);
+  /*! \brief number of stages */
+  int num_stages() const { return stages_.size(); }
+  /*! \brief number of items of the last Run */
+  int num_items() const { return num_items_; }
+  /*!
+   * \brief output of an item in the last Run
+   * \param stage index of the stage
+   * \param net index of the Net in the stage
+   * \param item index of the item
+   * \return output_dim(stage, net) values, valid until the next Run
+   */
+  const real_t* output(int stage, int net, int item) const;
+  /*! \brief number of output values per item of a Net */
+  int output_dim(int stage, int net) const;
+
+ private:
+  const Blob* output_blob(int stage, int net) const;
+
+  struct Stage {
+    std::vector<Net*> nets;
+    std::vector<Blob*> outputs;
+    Feeder feeder;
+  };
+  std::vector<Stage> stages_;
+  int num_items_ = 0;
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_CASCADE_HPP_
@@ -132,6 +132,44 @@ class CAFFE_API Net {
   /// @brief mark extra output named blob
   void MarkOutputs(const std::vector<std::string>& outs);
 
+  /**
+   * @brief Only compute the named blobs, layers they do not depend on are
+   *        skipped by Forward and their blobs released.
+   *
+   * The requested blobs are kept alive like marked outputs. An empty list
+   * brings back every layer. The set can be changed at any time between
+   * forwards. With release_params, weights of skipped layers are freed too,
+   * such layers can not be brought back and are skipped by
+   * CopyTrainedLayersFrom, so prune before loading the caffemodel to never
+   * hold their weights.
+   */
+  void SetOutputs(const std::vector<std::string>& outs,
+                  bool release_params = false);
+  /// @brief whether layer i runs in Forward
+  bool layer_active(int i) const { return layer_active_[i]; }
+
+  /**
+   * @brief Bind memory owned by the caller to a named blob, usually a network
+   *        input or output, so layers read or write it without copy.
+   *
+   * The memory must hold count() elements of the blob in its current shape
+   * and stay valid while bound. The blob is kept alive like an output. After
+   * reshaping the input call Reshape() and bind buffers of the new size.
+   * Layers which otherwise hand the memory of the bottom to the top, like
+   * Flatten, Reshape and Split, copy into a bound top instead.
+   */
+  void SetExternalData(const string& blob_name, real_t* data);
+
+  /**
+   * @brief Fill item n of a named Net input from an interleaved 8-bit image
+   *        of height x width x channels pixels, see Blob::SetImage.
+   *
+   * mean_value, scale and channel_swap come from the transform_param of the
+   * Input layer. The blob is reshaped to the image keeping its num.
+   */
+  void SetInputImage(const string& blob_name, const unsigned char* image,
+                     int height, int width, int channels, int n = 0);
+
   /// @brief Input and output blob numbers
   inline int num_inputs() const { return net_input_blobs_.size(); }
   inline int num_outputs() const { return net_output_blobs_.size(); }
@@ -168,6 +206,26 @@ class CAFFE_API Net {
   /// @brief Append a new parameter blob to the net.
   void AppendParam(const NetParameter& param, const int layer_id,
                    const int param_id);
+  /// @brief Recompute blob life time over the active layers.
+  void UpdateBlobLifeTime();
+  /// @brief First layer writing every blob.
+  vector<int> FindProducers() const;
+  /// @brief Find elementwise layers which may overwrite their bottom.
+  void PlanInPlace();
+  /// @brief Let layer i write its top into memory of its bottom if nothing
+  ///        reads the bottom afterwards.
+  void SetupInPlace(int i);
+  /// @brief Find Concat bottoms which their producers can write in place.
+  void PlanConcatViews();
+  /// @brief Tell every layer whether its tops may be views of its bottoms.
+  void PlanTopViews();
+  /// @brief Make bottom k of a planned Concat a view of its output.
+  void SetupConcatView(int plan_id, int k);
+  /// @brief Check planned views before a Concat runs, copy them out if the
+  ///        shapes changed, return whether the plan still holds.
+  bool CheckConcatViews(int plan_id);
+  /// @brief Record shapes of a Concat after it runs for the next forward.
+  void RecordConcatShapes(int plan_id);
 
   /// @brief The network name
   string name_;
@@ -179,6 +237,33 @@ class CAFFE_API Net {
   vector<shared_ptr<Blob> > blobs_;
   vector<string> blob_names_;
   vector<int> blob_life_time_;
+  /// @brief blobs never released during forward, inputs, marked and bound
+  vector<bool> blob_pinned_;
+  /// @brief blobs requested by SetOutputs
+  vector<int> requested_outputs_;
+  /// @brief layers run by Forward and layers whose weights are released
+  vector<bool> layer_active_;
+  vector<bool> layer_params_released_;
+  /**
+   * @brief Concat along an axis with outer count 1 is a plain sequence of
+   *        its bottoms, so bottoms which nothing else reads are produced as
+   *        views of the output. Shapes come from the previous forward.
+   */
+  struct ConcatPlan {
+    int layer_id;
+    vector<bool> view;  // bottoms produced as views
+    vector<vector<int> > bottom_shapes;
+    vector<int> top_shape;  // empty if views are not usable
+  };
+  vector<ConcatPlan> concat_plans_;
+  /// @brief per layer, plan id and bottom index of the views it produces
+  vector<vector<std::pair<int, int> > > layer_concat_views_;
+  /// @brief per layer, plan id of the Concat layer or -1
+  vector<int> layer_concat_plan_;
+  /// @brief elementwise layers run in place when their bottom is dead
+  vector<bool> layer_auto_inplace_;
+  /// @brief layers computed by the layer before them on CPU
+  vector<bool> layer_fused_;
   std::map<string, int> blob_names_index_;
   /// @brief parameters in the network.
   vector<shared_ptr<Blob> > params_;
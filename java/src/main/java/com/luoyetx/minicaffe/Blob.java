@@ -1,11 +1,16 @@
 package com.luoyetx.minicaffe;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.FloatBuffer;
 
 /**
  * Blob represent Caffe Blob
  * This class hold the data buffer stand alone in Java float array, process data
  * in Java side and call `syncToC` to copy data back to C side. Same happens when
  * we need to sync data from C side, call `syncToJava`.
+ * To avoid the copies and the Java heap allocation of every sync, use `buffer`
+ * which views the memory in C side directly.
  */
 public final class Blob {
     protected Blob() {}
@@ -25,8 +30,43 @@ public final class Blob {
             throw new RuntimeException(Utils.GetLastError());
         }
     }
+    /**
+     * reshape the blob in C side, `shape` and `data` in Java side are not
+     * touched, buffers returned by `buffer` before may become invalid
+     * @param shape new blob shape
+     */
+    public void reshape(int... shape) {
+        if (jniReshape(shape) != 0) {
+            throw new RuntimeException(Utils.GetLastError());
+        }
+    }
+    /**
+     * get current blob shape in C side
+     * @return blob shape
+     */
+    public int[] getShape() {
+        return jniGetShape();
+    }
+    /**
+     * view blob memory in C side as a direct FloatBuffer in native byte order,
+     * reading and writing it needs no sync, no copy and no Java array.
+     * The view is valid until the blob is reshaped or the network forward
+     * changes its memory (blobs not marked as output may be released), take a
+     * new view after that.
+     * @return direct buffer over blob data
+     */
+    public FloatBuffer buffer() {
+        ByteBuffer buffer = jniGetBuffer();
+        if (buffer == null) {
+            throw new RuntimeException("blob holds no data");
+        }
+        return buffer.order(ByteOrder.nativeOrder()).asFloatBuffer();
+    }
     private native int jniSyncToJava();
     private native int jniSyncToC();
+    private native int jniReshape(int[] shape);
+    private native int[] jniGetShape();
+    private native ByteBuffer jniGetBuffer();
     public int[] shape;
     public float[] data;
     // internal Blob handle
@@ -63,8 +63,18 @@ public final class Net {
      * @return blob
      */
     public Blob getBlob(String name) {
+        return getBlob(name, true);
+    }
+    /**
+     * get blob by name
+     * @param name blob name in network data buffers
+     * @param sync copy blob data to Java side, pass false when using
+     *             `Blob.buffer` to avoid the Java array allocation
+     * @return blob
+     */
+    public Blob getBlob(String name, boolean sync) {
         Blob blob = new Blob();
-        if (jniGetBlob(name, blob) != 0) {
+        if (jniGetBlob(name, blob, sync) != 0) {
             throw new RuntimeException(Utils.GetLastError());
         }
         return blob;
@@ -74,7 +84,7 @@ public final class Net {
     private native int jniDestroy();
     private native int jniMarkOutput(String name);
     private native int jniForward();
-    private native int jniGetBlob(String name, Blob blob);
+    private native int jniGetBlob(String name, Blob blob, boolean sync);
     // internal Net handle
     private long handle;
 
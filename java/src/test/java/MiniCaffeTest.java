@@ -54,5 +54,16 @@ public class MiniCaffeTest {
         net.forward();
         long end = System.currentTimeMillis();
         System.out.println("Forward Network costs " + (end - start) + " ms");
+        // direct buffer shares memory with C side
+        Blob view = net.getBlob("data", false);
+        assertNull(view.data);
+        java.nio.FloatBuffer buffer = view.buffer();
+        assertEquals(length, buffer.capacity());
+        for (int i = 0; i < length; i++) {
+            assertEquals(blob.data[i], buffer.get(i), 0);
+        }
+        buffer.put(0, 1.f);
+        view.syncToJava();
+        assertEquals(1.f, view.data[0], 0);
     }
 }
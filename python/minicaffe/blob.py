@@ -2,10 +2,30 @@
 """Blob represents caffe::Blob"""
 from __future__ import absolute_import
 import ctypes
-from .base import LIB
+import numpy as np
+from .base import LIB, real_t
 from .base import check_call, ctypes2numpy_shared
 
 
+def external_pointer(array):
+    """check a numpy array can be bound to a blob and return its data pointer
+
+    Parameters
+    ----------
+    array: numpy.array
+        C contiguous, aligned and writeable float32 array
+
+    Returns
+    -------
+    cptr: ctypes.POINTER(real_t)
+        pointer to the array data
+    """
+    if array.dtype != np.float32 or not array.flags['C_CONTIGUOUS'] or \
+       not array.flags['ALIGNED'] or not array.flags['WRITEABLE']:
+        raise ValueError('expected a C contiguous, aligned and writeable float32 array')
+    return array.ctypes.data_as(ctypes.POINTER(real_t))
+
+
 class Blob(object):
     """Blob in caffe, users shouldn't create object through this class.
     Always gets a reference from Net object
@@ -64,3 +84,30 @@ class Blob(object):
         shape = self.shape
         cptr = LIB.CaffeBlobData(self.handle)
         return ctypes2numpy_shared(cptr, shape)
+
+    @property
+    def __array_interface__(self):
+        """numpy array interface, `np.asarray(blob)` gives a view of the internal
+        data buffer without copy. The view is only valid until the blob is reshaped
+        or its network is destroyed.
+        """
+        cptr = LIB.CaffeBlobData(self.handle)
+        address = ctypes.cast(cptr, ctypes.c_void_p).value
+        return {'shape': tuple(self.shape),
+                'typestr': np.dtype(np.float32).str,
+                'data': (address, False),
+                'version': 3}
+
+    def set_external_data(self, array):
+        """use the memory of a numpy array as data of this blob without copy,
+        the blob is reshaped to the array shape. The caller must keep the array
+        alive while it is bound, prefer `Net.bind` which does that for you.
+
+        Parameters
+        ----------
+        array: numpy.array
+            C contiguous, aligned and writeable float32 array
+        """
+        cptr = external_pointer(array)
+        self.reshape(*array.shape)
+        check_call(LIB.CaffeBlobSetExternalData(self.handle, cptr))
@@ -4,10 +4,11 @@
 from __future__ import absolute_import
 from collections import defaultdict
 import ctypes
+import numpy as np
 from .base import LIB
 from .base import c_str, py_str, check_call
 from .base import NetHandle, BlobHandle
-from .blob import Blob
+from .blob import Blob, external_pointer
 
 
 class Net(object):
@@ -28,6 +29,8 @@ class Net(object):
         check_call(LIB.CaffeNetCreate(c_str(prototxt),
                                       c_str(caffemodel),
                                       ctypes.byref(self.handle)))
+        # arrays bound to blobs, keep them alive while the network uses them
+        self._external = dict()
 
     def __del__(self):
         """destruct object
@@ -107,16 +110,60 @@ class Net(object):
         """
         check_call(LIB.CaffeNetMarkOutput(self.handle, c_str(name)))
 
+    def set_outputs(self, names):
+        """only compute the given blobs, layers they do not depend on are skipped
+        by forward. Pass an empty list to run every layer again.
+
+        Parameters
+        ----------
+        names: list of string
+            blob names to compute
+        """
+        ctypes_names = (ctypes.c_char_p * len(names))(*[c_str(name) for name in names])
+        check_call(LIB.CaffeNetSetOutputs(self.handle, len(names), ctypes_names))
+
+    def bind(self, name, array):
+        """bind a numpy array to a network blob without copy, the network reads
+        input from or writes output to the array directly. The array is kept
+        alive by this network until another array is bound to the blob, or the
+        blob is reshaped beyond the array size, which drops the binding.
+
+        Parameters
+        ----------
+        name: string
+            blob name, usually network input or output
+        array: numpy.array
+            C contiguous, aligned and writeable float32 array with the blob shape
+        """
+        cptr = external_pointer(array)
+        self.get_blob(name).reshape(*array.shape)
+        # bound through the network, the blob is kept alive during forward
+        check_call(LIB.CaffeNetSetExternalData(self.handle, c_str(name), cptr))
+        self._external[name] = array
+
+    def _drop_unbound(self):
+        """forget arrays whose blobs were reshaped beyond them and lost the binding
+        """
+        for name, array in list(self._external.items()):
+            view = np.asarray(self.get_blob(name))
+            if view.ctypes.data != array.ctypes.data:
+                del self._external[name]
+
     def forward(self, **kwargs):
-        """forward network, need to fill data blobs before call this function
+        """forward network, need to fill data blobs before call this function.
+        The GIL is released while the network runs, so different networks can
+        forward in parallel from multiple Python threads.
 
         Parameters
         ==========
         kwargs: dict(str: np.array)
-            input blob map
+            input blob map, the arrays are copied into the blobs, use `bind` to
+            let the network read an array without copy
         """
         for k, v in kwargs.items():
             blob = self.get_blob(k)
             blob.reshape(*v.shape)
             blob.data[...] = v
+        self._drop_unbound()
+        # ctypes releases the GIL during the call
         check_call(LIB.CaffeNetForward(self.handle))
@@ -4,6 +4,7 @@
 from __future__ import print_function
 import os
 import sys
+import tempfile
 import time
 import numpy as np
 
@@ -62,6 +63,15 @@ def test_network():
     print('Forward ResNet costs %f ms'%t)
     # forward network by pass data
     net.forward(**{'data': np.random.rand(size).reshape(shape).astype(np.float32)})
+    # zero copy views and bound arrays
+    data = np.random.rand(size).reshape(shape).astype(np.float32)
+    net.bind('data', data)
+    view = np.asarray(net.get_blob('data'))
+    assert view.ctypes.data == data.ctypes.data
+    net.forward()
+    conv1 = np.array(net.get_blob('conv1').data)
+    net.forward(data=data)
+    assert np.allclose(conv1, net.get_blob('conv1').data)
     # network parameters
     params = net.params
     for layer_name, layer_params in list(params.items()):
@@ -79,7 +89,68 @@ def test_network():
     print('}')
 
 
+def test_forward_copy():
+    """forward copies its inputs, layers in place on an input never touch them"""
+    prototxt = """
+    layer { name: 'data' type: 'Input' top: 'data'
+            input_param { shape { dim: 1 dim: 8 } } }
+    layer { name: 'relu' type: 'ReLU' bottom: 'data' top: 'data' }
+    """
+    tmp_dir = tempfile.mkdtemp()
+    prototxt_path = os.path.join(tmp_dir, 'relu.prototxt')
+    caffemodel_path = os.path.join(tmp_dir, 'relu.caffemodel')
+    with open(prototxt_path, 'w') as fout:
+        fout.write(prototxt)
+    open(caffemodel_path, 'wb').close()
+    net = mcaffe.Net(prototxt_path, caffemodel_path)
+    x = np.array([[-1, 2, -3, 4, -5, 6, -7, 8]], dtype=np.float32)
+    net.forward(data=x)
+    assert np.all(x == [[-1, 2, -3, 4, -5, 6, -7, 8]])
+    assert np.all(net.get_blob('data').data == np.maximum(x, 0))
+    # a bound array is read in place and dropped once the blob outgrows it
+    y = x.copy()
+    net.bind('data', y)
+    net.forward()
+    assert np.all(y == np.maximum(x, 0))
+    net.forward(data=np.zeros((1, 4), np.float32))
+    assert np.asarray(net.get_blob('data')).ctypes.data == y.ctypes.data
+    net.forward(data=np.zeros((2, 8), np.float32))
+    assert 'data' not in net._external  # pylint: disable=protected-access
+
+
+def test_bind_flatten():
+    """arrays bound to outputs of Flatten and Reshape are written"""
+    prototxt = """
+    layer { name: 'data' type: 'Input' top: 'data'
+            input_param { shape { dim: 1 dim: 2 dim: 2 dim: 2 } } }
+    layer { name: 'flat' type: 'Flatten' bottom: 'data' top: 'flat' }
+    layer { name: 'reshape' type: 'Reshape' bottom: 'data' top: 'reshape'
+            reshape_param { shape { dim: 0 dim: -1 } } }
+    """
+    tmp_dir = tempfile.mkdtemp()
+    prototxt_path = os.path.join(tmp_dir, 'flatten.prototxt')
+    caffemodel_path = os.path.join(tmp_dir, 'flatten.caffemodel')
+    with open(prototxt_path, 'w') as fout:
+        fout.write(prototxt)
+    open(caffemodel_path, 'wb').close()
+    net = mcaffe.Net(prototxt_path, caffemodel_path)
+    x = np.arange(8, dtype=np.float32).reshape(1, 2, 2, 2)
+    outputs = {}
+    for name in ['flat', 'reshape']:
+        outputs[name] = np.full((1, 8), -999, dtype=np.float32)
+        net.bind(name, outputs[name])
+    for _ in range(2):
+        net.forward(data=x)
+        for name, array in outputs.items():
+            assert np.all(array == x.reshape(1, 8))
+            view = np.asarray(net.get_blob(name))
+            assert view.ctypes.data == array.ctypes.data
+        x = x + 1
+
+
 if __name__ == '__main__':
     # test crafter
     test_crafter()
+    test_forward_copy()
+    test_bind_flatten()
     test_network()
@@ -36,8 +36,11 @@ void Blob::Reshape(const vector<int>& shape) {
     shape_data[i] = shape[i];
   }
   if (count_ > capacity_) {
+    CHECK(!external_data()) << "Blob with external data of " << capacity_
+        << " elements can not be reshaped to " << shape_string();
     capacity_ = count_;
     data_.reset(new SyncedMemory(capacity_ * sizeof(real_t)));
+    offset_ = 0;
   }
 }
 
@@ -57,13 +60,13 @@ void Blob::ReshapeLike(const Blob& other) {
 Blob::Blob(const int num, const int channels,
            const int height, const int width)
     // capacity_ must be initialized before calling Reshape
-    : capacity_(0) {
+    : capacity_(0), offset_(0) {
   Reshape(num, channels, height, width);
 }
 
 Blob::Blob(const vector<int>& shape)
     // capacity_ must be initialized before calling Reshape
-    : capacity_(0) {
+    : capacity_(0), offset_(0) {
   Reshape(shape);
 }
 
@@ -74,22 +77,98 @@ const int* Blob::gpu_shape() const {
 
 const real_t* Blob::cpu_data() const {
   CHECK(data_);
-  return static_cast<const real_t*>(data_->cpu_data());
+  return static_cast<const real_t*>(data_->cpu_data()) + offset_;
 }
 
 real_t* Blob::mutable_cpu_data() {
   CHECK(data_);
-  return static_cast<real_t*>(data_->mutable_cpu_data());
+  return static_cast<real_t*>(data_->mutable_cpu_data()) + offset_;
 }
 
 const real_t* Blob::gpu_data() const {
   CHECK(data_);
-  return static_cast<const real_t*>(data_->gpu_data());
+  return static_cast<const real_t*>(data_->gpu_data()) + offset_;
 }
 
 real_t* Blob::mutable_gpu_data() {
   CHECK(data_);
-  return static_cast<real_t*>(data_->mutable_gpu_data());
+  return static_cast<real_t*>(data_->mutable_gpu_data()) + offset_;
+}
+
+void Blob::set_cpu_data(real_t* data) {
+  CHECK_GT(count_, 0) << "Blob should be shaped before binding external data";
+  data_.reset(new SyncedMemory(count_ * sizeof(real_t)));
+  data_->set_cpu_data(data);
+  capacity_ = count_;
+  offset_ = 0;
+}
+
+// a 3 channel image with the channel order known at compile time, pixels of
+// a tile are widened to float first so both loops vectorize
+template <int C0, int C1, int C2>
+static void ImageToPlanes3(const unsigned char* image, int spatial,
+                           const real_t* mean, real_t scale, real_t* data) {
+  const int kTile = 64;
+  real_t tile[3 * kTile];
+  const real_t mean0 = mean[0], mean1 = mean[1], mean2 = mean[2];
+  for (int begin = 0; begin < spatial; begin += kTile) {
+    const int num = spatial - begin < kTile ? spatial - begin : kTile;
+    const unsigned char* pixels = image + 3 * begin;
+    for (int i = 0; i < 3 * num; ++i) {
+      tile[i] = pixels[i];
+    }
+    real_t* plane0 = data + begin;
+    real_t* plane1 = plane0 + spatial;
+    real_t* plane2 = plane1 + spatial;
+    for (int i = 0; i < num; ++i) {
+      plane0[i] = (tile[3 * i + C0] - mean0) * scale;
+      plane1[i] = (tile[3 * i + C1] - mean1) * scale;
+      plane2[i] = (tile[3 * i + C2] - mean2) * scale;
+    }
+  }
+}
+
+void Blob::SetImage(int n, const unsigned char* image, int height, int width,
+                    int channels, const real_t* mean, real_t scale,
+                    const int* channel_order) {
+  CHECK_EQ(num_axes(), 4) << "Blob of an image should be (N, C, H, W)";
+  CHECK_GE(n, 0);
+  CHECK_LT(n, shape(0));
+  CHECK_EQ(shape(1), channels) << "image channels mismatch " << shape_string();
+  CHECK_EQ(shape(2), height) << "image height mismatch " << shape_string();
+  CHECK_EQ(shape(3), width) << "image width mismatch " << shape_string();
+  vector<int> order(channels);
+  vector<real_t> means(channels, 0);
+  for (int c = 0; c < channels; ++c) {
+    order[c] = channel_order != NULL ? channel_order[c] : c;
+    CHECK_GE(order[c], 0);
+    CHECK_LT(order[c], channels);
+    if (mean != NULL) {
+      means[c] = mean[c];
+    }
+  }
+  const int spatial = height * width;
+  real_t* data = mutable_cpu_data() + offset(n);
+  if (channels == 3 && order == vector<int>{0, 1, 2}) {
+    ImageToPlanes3<0, 1, 2>(image, spatial, &means[0], scale, data);
+  }
+  else if (channels == 3 && order == vector<int>{2, 1, 0}) {
+    ImageToPlanes3<2, 1, 0>(image, spatial, &means[0], scale, data);
+  }
+  else {
+    for (int c = 0; c < channels; ++c) {
+      const unsigned char* pixel = image + order[c];
+      const real_t channel_mean = means[c];
+      real_t* plane = data + c * spatial;
+      for (int i = 0; i < spatial; ++i) {
+        plane[i] = (pixel[i * channels] - channel_mean) * scale;
+      }
+    }
+  }
+}
+
+bool Blob::external_data() const {
+  return data_ && !data_->own_cpu_data();
 }
 
 void Blob::Release() {
@@ -99,12 +178,26 @@ void Blob::Release() {
   shape_.clear();
   count_ = 0;
   capacity_ = 0;
+  offset_ = 0;
 }
 
 void Blob::ShareData(const Blob& other) {
   CHECK_EQ(count_, other.count());
   CHECK(other.data_);
   data_ = other.data_;
+  offset_ = other.offset_;
+  capacity_ = count_;
+}
+
+void Blob::ShareData(const Blob& other, int offset) {
+  CHECK_GE(offset, 0);
+  CHECK_LE(offset + count_, other.count())
+      << "view " << shape_string() << " at " << offset
+      << " is out of range of " << other.shape_string();
+  CHECK(other.data_);
+  data_ = other.data_;
+  offset_ = other.offset_ + offset;
+  capacity_ = count_;
 }
 
 bool Blob::ShapeEquals(const BlobProto& other) {
@@ -137,8 +230,7 @@ void Blob::CopyFrom(const Blob& source, bool reshape) {
       LOG(FATAL) << "Trying to copy blobs of different sizes.";
     }
   }
-  caffe_copy(count_, source.cpu_data(),
-             static_cast<real_t*>(data_->mutable_cpu_data()));
+  caffe_copy(count_, source.cpu_data(), mutable_cpu_data());
 }
 
 void Blob::FromProto(const BlobProto& proto, bool reshape) {
@@ -193,22 +285,22 @@ void Blob::ToProto(BlobProto* proto) const {
 
 const int* BlobInt::cpu_data() const {
   CHECK(data_);
-  return static_cast<const int*>(data_->cpu_data());
+  return static_cast<const int*>(data_->cpu_data()) + offset_;
 }
 
 int* BlobInt::mutable_cpu_data() {
   CHECK(data_);
-  return static_cast<int*>(data_->mutable_cpu_data());
+  return static_cast<int*>(data_->mutable_cpu_data()) + offset_;
 }
 
 const int* BlobInt::gpu_data() const {
   CHECK(data_);
-  return static_cast<const int*>(data_->gpu_data());
+  return static_cast<const int*>(data_->gpu_data()) + offset_;
 }
 
 int* BlobInt::mutable_gpu_data() {
   CHECK(data_);
-  return static_cast<int*>(data_->mutable_gpu_data());
+  return static_cast<int*>(data_->mutable_gpu_data()) + offset_;
 }
 
 shared_ptr<Blob> ReadBlobFromFile(const string& file) {
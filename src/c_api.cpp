@@ -1,9 +1,11 @@
+#include <cstring>
 #include <mutex>
 
 #include "caffe/c_api.h"
 #include "caffe/blob.hpp"
 #include "caffe/net.hpp"
 #include "caffe/profiler.hpp"
+#include "./layer.hpp"
 #include "./thread_local.hpp"
 
 #define API_BEGIN() try {
@@ -40,10 +42,23 @@ int CaffeBlobCount(BlobHandle blob) {
 
 typedef ThreadLocalStore<std::vector<int> > BlobShapeStore;
 
+static void ReshapeBlob(caffe::Blob* blob, int shape_size, const int* shape) {
+  std::vector<int> shape_data(shape, shape + shape_size);
+  int count = 1;
+  for (int dim : shape_data) {
+    count *= dim;
+  }
+  if (blob->external_data() && count > blob->capacity()) {
+    // the bound buffer is too small, fall back to pool memory until the
+    // caller binds a larger one
+    blob->Release();
+  }
+  blob->Reshape(shape_data);
+}
+
 int CaffeBlobReshape(BlobHandle blob, int shape_size, int* shape) {
   API_BEGIN();
-  std::vector<int> shape_data(shape, shape + shape_size);
-  static_cast<caffe::Blob*>(blob)->Reshape(shape_data);
+  ReshapeBlob(static_cast<caffe::Blob*>(blob), shape_size, shape);
   API_END();
 }
 
@@ -56,6 +71,22 @@ int CaffeBlobShape(BlobHandle blob, int* shape_size, int** shape) {
   API_END();
 }
 
+int CaffeBlobSetExternalData(BlobHandle blob, real_t *data) {
+  API_BEGIN();
+  static_cast<caffe::Blob*>(blob)->set_cpu_data(data);
+  API_END();
+}
+
+int CaffeBlobSetImage(BlobHandle blob, int n, const unsigned char *image,
+                      int height, int width, int channels,
+                      const real_t *mean, real_t scale,
+                      const int *channel_order) {
+  API_BEGIN();
+  static_cast<caffe::Blob*>(blob)->SetImage(n, image, height, width, channels,
+                                            mean, scale, channel_order);
+  API_END();
+}
+
 int CaffeNetCreate(const char *net_path, const char *model_path,
                    NetHandle *net) {
   API_BEGIN();
@@ -91,12 +122,67 @@ int CaffeNetMarkOutput(NetHandle net, const char *name) {
   API_END();
 }
 
+int CaffeNetSetExternalData(NetHandle net, const char *name, real_t *data) {
+  API_BEGIN();
+  static_cast<caffe::Net*>(net)->SetExternalData(name, data);
+  API_END();
+}
+
+int CaffeNetSetOutputs(NetHandle net, int n, const char **names) {
+  API_BEGIN();
+  static_cast<caffe::Net*>(net)->SetOutputs(
+      std::vector<std::string>(names, names + n));
+  API_END();
+}
+
 int CaffeNetForward(NetHandle net) {
   API_BEGIN();
   static_cast<caffe::Net*>(net)->Forward();
   API_END();
 }
 
+int CaffeNetSetInputImage(NetHandle net, const char *name, int n,
+                          const unsigned char *image,
+                          int height, int width, int channels) {
+  API_BEGIN();
+  static_cast<caffe::Net*>(net)->SetInputImage(name, image, height, width,
+                                               channels, n);
+  API_END();
+}
+
+int CaffeNetRun(NetHandle net,
+                int n_input, const BlobHandle *inputs,
+                const int *input_ndims, const int *const *input_shapes,
+                const real_t *const *input_data,
+                int n_output, const BlobHandle *outputs,
+                const int *output_capacity, real_t *const *output_data) {
+  API_BEGIN();
+  for (int i = 0; i < n_input; i++) {
+    caffe::Blob* blob = static_cast<caffe::Blob*>(inputs[i]);
+    if (input_ndims != NULL && input_ndims[i] > 0) {
+      ReshapeBlob(blob, input_ndims[i], input_shapes[i]);
+    }
+    real_t* data = blob->mutable_cpu_data();
+    if (data != input_data[i]) {
+      memcpy(data, input_data[i], blob->count() * sizeof(real_t));
+    }
+  }
+  static_cast<caffe::Net*>(net)->Forward();
+  for (int i = 0; i < n_output; i++) {
+    caffe::Blob* blob = static_cast<caffe::Blob*>(outputs[i]);
+    // released blobs lose their shape, empty outputs like rois keep it
+    CHECK_GT(blob->num_axes(), 0) << "output " << i << " was released by "
+      "forward, mark it by CaffeNetMarkOutput first";
+    CHECK_LE(blob->count(), output_capacity[i])
+      << "output buffer " << i << " is too small";
+    const real_t* data = blob->cpu_data();
+    if (data != output_data[i]) {
+      memcpy(output_data[i], data, blob->count() * sizeof(real_t));
+    }
+  }
+  API_END();
+}
+
 int CaffeNetGetBlob(NetHandle net, const char *name, BlobHandle *blob) {
   API_BEGIN();
   std::shared_ptr<caffe::Blob> blob_ = static_cast<caffe::Net*>(net)->blob_by_name(name);
@@ -181,6 +267,53 @@ int CaffeNetListParam(NetHandle net, int *n, const char ***names, BlobHandle **p
   API_END();
 }
 
+struct DetectionEntry {
+  std::vector<real_t> detections;
+};
+
+typedef ThreadLocalStore<DetectionEntry> DetectionStore;
+
+int CaffeDetectionOutput(BlobHandle rois, BlobHandle scores,
+                         BlobHandle im_info, BlobHandle deltas,
+                         int background_label, real_t confidence_threshold,
+                         real_t nms_threshold, int top_k, int keep_top_k,
+                         int *n, const real_t **detections) {
+  API_BEGIN();
+  CHECK_GE(top_k, 0);
+  CHECK_GE(keep_top_k, 0);
+  CHECK(deltas == NULL || im_info != NULL) << "box deltas need im_info";
+  caffe::LayerParameter param;
+  param.set_type("DetectionOutput");
+  auto *detection_param = param.mutable_detection_output_param();
+  detection_param->set_background_label_id(background_label);
+  detection_param->set_confidence_threshold(confidence_threshold);
+  detection_param->set_nms_threshold(nms_threshold);
+  detection_param->set_top_k(top_k);
+  detection_param->set_keep_top_k(keep_top_k);
+  std::vector<caffe::Blob*> bottom = {
+    static_cast<caffe::Blob*>(rois), static_cast<caffe::Blob*>(scores) };
+  if (im_info != NULL) {
+    bottom.push_back(static_cast<caffe::Blob*>(im_info));
+  }
+  if (deltas != NULL) {
+    bottom.push_back(static_cast<caffe::Blob*>(deltas));
+  }
+  caffe::Blob output;
+  std::vector<caffe::Blob*> top = { &output };
+  auto layer = caffe::LayerRegistry::CreateLayer(param);
+  layer->SetUp(bottom, top);
+  layer->Forward(bottom, top);
+  auto *ret = DetectionStore::Get();
+  ret->detections.clear();
+  if (output.count() > 0) {
+    ret->detections.assign(output.cpu_data(),
+                           output.cpu_data() + output.count());
+  }
+  *n = output.shape(0);
+  *detections = ret->detections.data();
+  API_END();
+}
+
 int CaffeGPUAvailable() {
 #ifdef USE_CUDA
   return 1;
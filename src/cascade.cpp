@@ -0,0 +1,66 @@
+#include "caffe/cascade.hpp"
+
+namespace caffe {
+
+int Cascade::AddStage(const std::vector<Net*>& nets, const std::string& output,
+                      const Feeder& feeder) {
+  CHECK(!nets.empty()) << "stage has no Net";
+  CHECK(feeder) << "stage has no feeder";
+  Stage stage;
+  stage.nets = nets;
+  stage.feeder = feeder;
+  for (Net* net : nets) {
+    CHECK(net != NULL);
+    CHECK_GE(net->num_inputs(), 1) << "Net has no input to feed";
+    CHECK(net->has_blob(output))
+        << "blob (" << output << ") is not availiable in Net";
+    // keep the output alive after Forward, later stages read it in place
+    net->MarkOutputs(std::vector<std::string>(1, output));
+    stage.outputs.push_back(net->blob_by_name(output).get());
+  }
+  stages_.push_back(stage);
+  return stages_.size() - 1;
+}
+
+void Cascade::Run(int num_items) {
+  CHECK_GT(num_items, 0);
+  num_items_ = num_items;
+  for (Stage& stage : stages_) {
+    const int num_nets = stage.nets.size();
+    for (int i = 0; i < num_nets; ++i) {
+      Net* net = stage.nets[i];
+      Blob* input = net->input_blobs()[0];
+      CHECK_GT(input->num_axes(), 0) << "input of Net has no shape";
+      vector<int> shape = input->shape();
+      shape[0] = num_items;
+      input->Reshape(shape);
+      for (int item = 0; item < num_items; ++item) {
+        stage.feeder(i, item, input);
+      }
+      net->Forward();
+      CHECK_EQ(stage.outputs[i]->shape(0), num_items)
+          << "output of Net is not batched along the inputs";
+    }
+  }
+}
+
+const Blob* Cascade::output_blob(int stage, int net) const {
+  CHECK_GE(stage, 0);
+  CHECK_LT(stage, num_stages());
+  CHECK_GE(net, 0);
+  CHECK_LT(net, static_cast<int>(stages_[stage].outputs.size()));
+  return stages_[stage].outputs[net];
+}
+
+const real_t* Cascade::output(int stage, int net, int item) const {
+  CHECK_GE(item, 0);
+  CHECK_LT(item, num_items_);
+  const Blob* blob = output_blob(stage, net);
+  return blob->cpu_data() + blob->offset(item);
+}
+
+int Cascade::output_dim(int stage, int net) const {
+  return output_blob(stage, net)->count(1);
+}
+
+}  // namespace caffe
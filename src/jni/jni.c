@@ -73,6 +73,42 @@ CaffeJNIMethod(Blob, SyncToC, jint)(JNIEnv *env, jobject thiz) {
   return 0;
 }
 
+CaffeJNIMethod(Blob, Reshape, jint)(JNIEnv *env, jobject thiz,
+                                    jintArray shape) {
+  BlobHandle blob;
+  JNIGetHandleFromObj(thiz, blob);
+  int shape_size = (*env)->GetArrayLength(env, shape);
+  jint* shape_data = (*env)->GetPrimitiveArrayCritical(env, shape, NULL);
+  CHECK_SUCCESS(CaffeBlobReshape(blob, shape_size, shape_data), {
+    (*env)->ReleasePrimitiveArrayCritical(env, shape, shape_data, JNI_ABORT);
+  });
+  return 0;
+}
+
+CaffeJNIMethod(Blob, GetShape, jintArray)(JNIEnv *env, jobject thiz) {
+  BlobHandle blob;
+  JNIGetHandleFromObj(thiz, blob);
+  int shape_size = 0;
+  int* shape_data = NULL;
+  CaffeBlobShape(blob, &shape_size, &shape_data);
+  jintArray java_shape = (*env)->NewIntArray(env, shape_size);
+  (*env)->SetIntArrayRegion(env, java_shape, 0, shape_size, shape_data);
+  return java_shape;
+}
+
+CaffeJNIMethod(Blob, GetBuffer, jobject)(JNIEnv *env, jobject thiz) {
+  BlobHandle blob;
+  JNIGetHandleFromObj(thiz, blob);
+  int length = CaffeBlobCount(blob);
+  if (length == 0) {
+    // released or empty blob has no memory to view
+    return NULL;
+  }
+  // wrap C memory, no copy and nothing on Java heap besides the buffer object
+  float *data = CaffeBlobData(blob);
+  return (*env)->NewDirectByteBuffer(env, data, (jlong)length * sizeof(float));
+}
+
 // class Net
 
 CaffeJNIMethod(Net, Create, jint)(JNIEnv *env, jobject thiz,
@@ -132,7 +168,8 @@ CaffeJNIMethod(Net, Forward, jint)(JNIEnv *env, jobject thiz) {
 }
 
 CaffeJNIMethod(Net, GetBlob, jint)(JNIEnv *env, jobject thiz,
-                                   jstring name, jobject blob) {
+                                   jstring name, jobject blob,
+                                   jboolean sync) {
   NetHandle net;
   BlobHandle blob_;
   JNIGetHandleFromObj(thiz, net);
@@ -142,7 +179,9 @@ CaffeJNIMethod(Net, GetBlob, jint)(JNIEnv *env, jobject thiz,
   });
   // set blob handle
   JNISetHandleToObj(blob, blob_);
-  CaffeJNIMethodName(Blob, SyncToJava)(env, blob);
+  if (sync) {
+    CaffeJNIMethodName(Blob, SyncToJava)(env, blob);
+  }
   return 0;
 }
 
@@ -118,6 +118,24 @@ class Layer {
   /*! \brief clear internal buffer */
   virtual void ClearInternalBuffer() {}
 
+  /**
+   * @brief Take over the computation of layer next, which works in place on
+   *        the only top of this layer, so Net skips next on CPU.
+   *
+   * next keeps its parameter blobs, a layer fusing it shares them and reads
+   * them on every forward, so weights loaded later are picked up.
+   *
+   * \return whether Forward_cpu of this layer computes next as well
+   */
+  virtual bool FuseNext(Layer* /*next*/) { return false; }
+
+  /**
+   * @brief Allow the layer to give its tops memory of its bottoms instead of
+   *        copying. Net allows it at Init when nothing writes in place to
+   *        the tops, nor to other blobs seeing the memory of the bottoms.
+   */
+  virtual void AllowTopViews(bool /*allow*/) {}
+
   /**
    * @brief Returns the vector of learnable parameter blobs.
    */
@@ -8,6 +8,15 @@
 
 namespace caffe {
 
+// GEMMs over small outputs run well below peak, so on CPU images whose
+// output is under half of kGemmColumns are batched into one GEMM
+static const int kGemmColumns = 256;
+// Column buffers larger than kMaxColumnBuffer elements are not filled at
+// once on CPU, im2col fills panels of whole output rows of about
+// kColumnPanel elements and each panel goes through the GEMM in turn
+static const int kMaxColumnBuffer = 1 << 21;
+static const int kColumnPanel = 1 << 19;
+
 void BaseConvolutionLayer::LayerSetUp(const vector<Blob*>& bottom,
                                       const vector<Blob*>& top) {
   // Configure the kernel size, padding, stride, and inputs.
@@ -235,6 +244,20 @@ void BaseConvolutionLayer::Reshape(const vector<Blob*>& bottom,
     }
   }
   col_buffer_.Reshape(col_buffer_shape_);
+  gemm_batch_ = 1;
+  if (!reverse_dimensions() && conv_out_spatial_dim_ > 0 &&
+      conv_out_spatial_dim_ < kGemmColumns / 2) {
+    gemm_batch_ = std::min(num_, (kGemmColumns + conv_out_spatial_dim_ - 1) /
+                                 conv_out_spatial_dim_);
+  }
+  panel_rows_ = 0;
+  if (!reverse_dimensions() && !is_1x1_ && !force_nd_im2col_ &&
+      num_spatial_axes_ == 2 && gemm_batch_ == 1 &&
+      col_buffer_.count() > kMaxColumnBuffer) {
+    const int row_size = kernel_dim_ * group_ * output_shape_[1];
+    panel_rows_ = std::max(1, kColumnPanel / row_size);
+    panel_buffer_.Reshape(vector<int>(1, row_size * panel_rows_));
+  }
   bottom_dim_ = bottom[0]->count(channel_axis_);
   top_dim_ = top[0]->count(channel_axis_);
   num_kernels_im2col_ = conv_in_channels_ * conv_out_spatial_dim_;
@@ -253,6 +276,24 @@ void BaseConvolutionLayer::forward_cpu_gemm(const real_t* input,
                                             const real_t* weights,
                                             real_t* output,
                                             bool skip_im2col) {
+  if (panel_rows_ > 0 && !skip_im2col) {
+    const int output_h = output_shape_[0];
+    const int output_w = output_shape_[1];
+    real_t* panel = panel_buffer_.mutable_cpu_data();
+    for (int row = 0; row < output_h; row += panel_rows_) {
+      const int row_end = std::min(row + panel_rows_, output_h);
+      const int columns = (row_end - row) * output_w;
+      conv_im2col_panel_cpu(input, row, row_end, panel);
+      for (int g = 0; g < group_; ++g) {
+        caffe_cpu_gemm(CblasNoTrans, CblasNoTrans,
+          conv_out_channels_ / group_, columns, kernel_dim_,
+          static_cast<real_t>(1), weights + weight_offset_ * g,
+          panel + kernel_dim_ * columns * g, static_cast<real_t>(0),
+          output + output_offset_ * g + row * output_w, conv_out_spatial_dim_);
+      }
+    }
+    return;
+  }
   const real_t* col_buff = input;
   if (!is_1x1_) {
     if (!skip_im2col) {
@@ -275,6 +316,55 @@ void BaseConvolutionLayer::forward_cpu_bias(real_t* output,
     static_cast<real_t>(1), output);
 }
 
+void BaseConvolutionLayer::forward_cpu_gemm_batch(const real_t* input,
+                                                  const real_t* weights,
+                                                  const real_t* bias,
+                                                  real_t* output,
+                                                  int batch) {
+  const int spatial = conv_out_spatial_dim_;
+  const int columns = batch * spatial;
+  const int col_rows = kernel_dim_ * group_;
+  batch_buffer_.Reshape(
+      vector<int>(1, (col_rows + conv_out_channels_) * columns));
+  real_t* col_buff = batch_buffer_.mutable_cpu_data();
+  real_t* out_buff = col_buff + col_rows * columns;
+  // image n fills columns [n * spatial, (n + 1) * spatial) of every row
+  for (int n = 0; n < batch; ++n) {
+    const real_t* cols = input + n * bottom_dim_;
+    if (!is_1x1_) {
+      conv_im2col_cpu(cols, col_buffer_.mutable_cpu_data());
+      cols = col_buffer_.cpu_data();
+    }
+    for (int r = 0; r < col_rows; ++r) {
+      std::copy(cols + r * spatial, cols + (r + 1) * spatial,
+                col_buff + r * columns + n * spatial);
+    }
+  }
+  const int out_rows = conv_out_channels_ / group_;
+  for (int g = 0; g < group_; ++g) {
+    caffe_cpu_gemm(CblasNoTrans, CblasNoTrans, out_rows, columns, kernel_dim_,
+      static_cast<real_t>(1), weights + weight_offset_ * g,
+      col_buff + kernel_dim_ * columns * g,
+      static_cast<real_t>(0), out_buff + out_rows * columns * g);
+  }
+  // scatter the rows back to the images and add the bias on the way
+  for (int n = 0; n < batch; ++n) {
+    for (int c = 0; c < num_output_; ++c) {
+      const real_t* src = out_buff + c * columns + n * spatial;
+      real_t* dst = output + n * top_dim_ + c * spatial;
+      if (bias) {
+        const real_t b = bias[c];
+        for (int s = 0; s < spatial; ++s) {
+          dst[s] = src[s] + b;
+        }
+      }
+      else {
+        std::copy(src, src + spatial, dst);
+      }
+    }
+  }
+}
+
 void BaseConvolutionLayer::backward_cpu_gemm(const real_t* output,
                                              const real_t* weights,
                                              real_t* input) {
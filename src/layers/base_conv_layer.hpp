@@ -22,6 +22,8 @@ class BaseConvolutionLayer : public Layer {
                        const vector<Blob*>& top);
   virtual void ClearInternalBuffer() {
     col_buffer_.Release();
+    batch_buffer_.Release();
+    panel_buffer_.Release();
   }
 
   virtual int MinBottomBlobs() const { return 1; }
@@ -35,6 +37,10 @@ class BaseConvolutionLayer : public Layer {
   void forward_cpu_gemm(const real_t* input, const real_t* weights,
                         real_t* output, bool skip_im2col = false);
   void forward_cpu_bias(real_t* output, const real_t* bias);
+  // forward_cpu_gemm and forward_cpu_bias of batch images at once, their
+  // columns are laid side by side so each group runs a single GEMM.
+  void forward_cpu_gemm_batch(const real_t* input, const real_t* weights,
+                              const real_t* bias, real_t* output, int batch);
   void backward_cpu_gemm(const real_t* input, const real_t* weights,
                          real_t* output);
 
@@ -86,6 +92,8 @@ class BaseConvolutionLayer : public Layer {
   bool bias_term_;
   bool is_1x1_;
   bool force_nd_im2col_;
+  /// @brief images per GEMM on CPU, 1 when outputs are large enough alone
+  int gemm_batch_;
 
  private:
   // wrap im2col/col2im so we don't have to remember the (long) argument lists
@@ -103,6 +111,16 @@ class BaseConvolutionLayer : public Layer {
           pad_.cpu_data(), stride_.cpu_data(), dilation_.cpu_data(), col_buff);
     }
   }
+  inline void conv_im2col_panel_cpu(const real_t* data, int row_begin,
+                                    int row_end, real_t* panel) {
+    im2col_panel_cpu(data, conv_in_channels_,
+        conv_input_shape_.cpu_data()[1], conv_input_shape_.cpu_data()[2],
+        kernel_shape_.cpu_data()[0], kernel_shape_.cpu_data()[1],
+        pad_.cpu_data()[0], pad_.cpu_data()[1],
+        stride_.cpu_data()[0], stride_.cpu_data()[1],
+        dilation_.cpu_data()[0], dilation_.cpu_data()[1],
+        row_begin, row_end, panel);
+  }
   inline void conv_col2im_cpu(const real_t* col_buff, real_t* data) {
     if (!force_nd_im2col_ && num_spatial_axes_ == 2) {
       col2im_cpu(col_buff, conv_in_channels_,
@@ -165,6 +183,11 @@ class BaseConvolutionLayer : public Layer {
 
   Blob col_buffer_;
   Blob bias_multiplier_;
+  /// columns and outputs of forward_cpu_gemm_batch
+  Blob batch_buffer_;
+  /// output rows per im2col panel on CPU, 0 fills col_buffer_ at once
+  int panel_rows_;
+  Blob panel_buffer_;
 };
 
 }  // namespace caffe
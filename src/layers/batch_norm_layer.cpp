@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cmath>
 #include <vector>
 
 #include "./batch_norm_layer.hpp"
@@ -40,6 +41,10 @@ void BatchNormLayer::Reshape(const vector<Blob*>& bottom,
     CHECK_EQ(bottom[0]->shape(1), channels_);
   top[0]->ReshapeLike(*bottom[0]);
 
+  if (use_global_stats_ && Caffe::mode() == Caffe::CPU) {
+    // ForwardGlobalStats_cpu needs none of the buffers below
+    return;
+  }
   vector<int> sz;
   sz.push_back(channels_);
   mean_.Reshape(sz);
@@ -67,8 +72,68 @@ void BatchNormLayer::Reshape(const vector<Blob*>& bottom,
   }
 }
 
+bool BatchNormLayer::FuseNext(Layer* next) {
+  if (!use_global_stats_ || string(next->type()) != "Scale") {
+    return false;
+  }
+  const ScaleParameter& param = next->layer_param().scale_param();
+  const vector<shared_ptr<Blob> >& blobs = next->blobs();
+  if (next->layer_param().bottom_size() != 1 || param.axis() != 1 ||
+      param.num_axes() != 1 || blobs.empty() ||
+      blobs[0]->count() != channels_) {
+    return false;
+  }
+  fused_scale_ = blobs[0];
+  if (param.bias_term()) {
+    fused_bias_ = blobs[1];
+  }
+  return true;
+}
+
+void BatchNormLayer::ForwardGlobalStats_cpu(const vector<Blob*>& bottom,
+                                            const vector<Blob*>& top) {
+  // per channel work only, cheap enough to follow weights on every forward
+  const real_t scale_factor = this->blobs_[2]->cpu_data()[0] == 0 ?
+      0 : 1 / this->blobs_[2]->cpu_data()[0];
+  const real_t* mean = this->blobs_[0]->cpu_data();
+  const real_t* variance = this->blobs_[1]->cpu_data();
+  scale_.resize(channels_);
+  shift_.resize(channels_);
+  for (int c = 0; c < channels_; ++c) {
+    scale_[c] = 1 / std::sqrt(variance[c] * scale_factor + eps_);
+    shift_[c] = -mean[c] * scale_factor * scale_[c];
+  }
+  if (fused_scale_) {
+    const real_t* gamma = fused_scale_->cpu_data();
+    const real_t* beta = fused_bias_ ? fused_bias_->cpu_data() : NULL;
+    for (int c = 0; c < channels_; ++c) {
+      scale_[c] *= gamma[c];
+      shift_[c] = shift_[c] * gamma[c] + (beta ? beta[c] : 0);
+    }
+  }
+  const real_t* bottom_data = bottom[0]->cpu_data();
+  real_t* top_data = top[0]->mutable_cpu_data();
+  const int num = bottom[0]->shape(0);
+  const int spatial_dim = bottom[0]->count() / (channels_ * num);
+  for (int n = 0; n < num; ++n) {
+    for (int c = 0; c < channels_; ++c) {
+      const real_t a = scale_[c];
+      const real_t b = shift_[c];
+      for (int i = 0; i < spatial_dim; ++i) {
+        top_data[i] = bottom_data[i] * a + b;
+      }
+      bottom_data += spatial_dim;
+      top_data += spatial_dim;
+    }
+  }
+}
+
 void BatchNormLayer::Forward_cpu(const vector<Blob*>& bottom,
                                  const vector<Blob*>& top) {
+  if (use_global_stats_) {
+    ForwardGlobalStats_cpu(bottom, top);
+    return;
+  }
   const real_t* bottom_data = bottom[0]->cpu_data();
   real_t* top_data = top[0]->mutable_cpu_data();
   int num = bottom[0]->shape(0);
@@ -50,6 +50,8 @@ class BatchNormLayer : public Layer {
     variance_.Release();
     temp_.Release();
   }
+  /// @brief fuse a following in-place Scale layer along channels
+  virtual bool FuseNext(Layer* next);
 
   virtual const char* type() const { return "BatchNorm"; }
   virtual int ExactNumBottomBlobs() const { return 1; }
@@ -61,7 +63,18 @@ class BatchNormLayer : public Layer {
   virtual void Forward_gpu(const vector<Blob*>& bottom,
                            const vector<Blob*>& top);
 
+  /**
+   * @brief apply stored statistics as y = x * scale + shift per channel in
+   *        one pass, folding in the fused Scale layer
+   */
+  void ForwardGlobalStats_cpu(const vector<Blob*>& bottom,
+                              const vector<Blob*>& top);
+
   Blob mean_, variance_, temp_;
+  // per channel scale and shift of the global statistics path
+  vector<real_t> scale_, shift_;
+  // parameters of the fused Scale layer, bias may be null
+  shared_ptr<Blob> fused_scale_, fused_bias_;
   bool use_global_stats_;
   int channels_;
   real_t eps_;
@@ -45,20 +45,33 @@ void ConcatLayer::Reshape(const vector<Blob*>& bottom,
   }
   top[0]->Reshape(top_shape);
   CHECK_EQ(bottom_count_sum, top[0]->count());
-  if (bottom.size() == 1) {
+  // memory bound by the caller is written by Forward instead
+  if (bottom.size() == 1 && !top[0]->external_data()) {
     top[0]->ShareData(*bottom[0]);
   }
 }
 
 void ConcatLayer::Forward_cpu(const vector<Blob*>& bottom,
                               const vector<Blob*>& top) {
-  if (bottom.size() == 1) { return; }
+  if (bottom.size() == 1) {
+    if (top[0]->external_data()) {
+      caffe_copy(top[0]->count(), bottom[0]->cpu_data(),
+                 top[0]->mutable_cpu_data());
+    }
+    return;
+  }
   real_t* top_data = top[0]->mutable_cpu_data();
   int offset_concat_axis = 0;
   const int top_concat_axis = top[0]->shape(concat_axis_);
   for (int i = 0; i < bottom.size(); ++i) {
     const real_t* bottom_data = bottom[i]->cpu_data();
     const int bottom_concat_axis = bottom[i]->shape(concat_axis_);
+    if (num_concats_ == 1 &&
+        bottom_data == top_data + offset_concat_axis * concat_input_size_) {
+      // bottom is a view of its part of top, already in place
+      offset_concat_axis += bottom_concat_axis;
+      continue;
+    }
     for (int n = 0; n < num_concats_; ++n) {
       caffe_copy(bottom_concat_axis * concat_input_size_,
         bottom_data + n * bottom_concat_axis * concat_input_size_,
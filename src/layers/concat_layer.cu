@@ -25,7 +25,13 @@ __global__ void Concat(const int nthreads, const real_t* in_data,
 
 void ConcatLayer::Forward_gpu(const vector<Blob*>& bottom,
                               const vector<Blob*>& top) {
-  if (bottom.size() == 1) { return; }
+  if (bottom.size() == 1) {
+    if (top[0]->external_data()) {
+      caffe_copy(top[0]->count(), bottom[0]->gpu_data(),
+                 top[0]->mutable_gpu_data());
+    }
+    return;
+  }
   real_t* top_data = top[0]->mutable_gpu_data();
   int offset_concat_axis = 0;
   const int top_concat_axis = top[0]->shape(concat_axis_);
@@ -33,6 +39,12 @@ void ConcatLayer::Forward_gpu(const vector<Blob*>& bottom,
   for (int i = 0; i < bottom.size(); ++i) {
     const real_t* bottom_data = bottom[i]->gpu_data();
     const int bottom_concat_axis = bottom[i]->shape(concat_axis_);
+    if (num_concats_ == 1 &&
+        bottom_data == top_data + offset_concat_axis * concat_input_size_) {
+      // bottom is a view of its part of top, already in place
+      offset_concat_axis += bottom_concat_axis;
+      continue;
+    }
     const int bottom_concat_size = bottom_concat_axis * concat_input_size_;
     const int nthreads = bottom_concat_size * num_concats_;
     Concat  // NOLINT_NEXT_LINE(whitespace/operators)
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <vector>
 
 #include "./conv_layer.hpp"
@@ -29,6 +30,16 @@ void ConvolutionLayer::Forward_cpu(const vector<Blob*>& bottom,
   for (int i = 0; i < bottom.size(); ++i) {
     const real_t* bottom_data = bottom[i]->cpu_data();
     real_t* top_data = top[i]->mutable_cpu_data();
+    if (this->gemm_batch_ > 1) {
+      const real_t* bias =
+          this->bias_term_ ? this->blobs_[1]->cpu_data() : NULL;
+      for (int n = 0; n < this->num_; n += this->gemm_batch_) {
+        const int batch = std::min(this->gemm_batch_, this->num_ - n);
+        this->forward_cpu_gemm_batch(bottom_data + n * this->bottom_dim_,
+            weight, bias, top_data + n * this->top_dim_, batch);
+      }
+      continue;
+    }
     for (int n = 0; n < this->num_; ++n) {
       this->forward_cpu_gemm(bottom_data + n * this->bottom_dim_, weight,
           top_data + n * this->top_dim_);
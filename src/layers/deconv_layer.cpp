@@ -1,6 +1,10 @@
+#include <algorithm>
+#include <cstring>
 #include <vector>
 
 #include "./deconv_layer.hpp"
+#include "../syncedmem.hpp"
+#include "../util/math_functions.hpp"
 
 #ifdef USE_CUDNN
 #include "./cudnn/cudnn_deconv_layer.hpp"
@@ -24,12 +28,195 @@ void DeconvolutionLayer::compute_output_shape() {
   }
 }
 
+// The phase forward batches images until a GEMM has about kPhaseColumns
+// columns, unless its shifted input rows would pass kMaxPhasePanel elements
+static const int kPhaseColumns = 1024;
+static const int kMaxPhasePanel = 1 << 20;
+// A phase GEMM has one row per output channel of a group, fewer rows than
+// this run well below the single GEMM of the col2im path
+static const int kMinPhaseRows = 16;
+
+bool DeconvolutionLayer::UsePhaseKernel() {
+  if (this->force_nd_im2col_ || this->num_spatial_axes_ != 2 ||
+      this->num_output_ / this->group_ < kMinPhaseRows) {
+    return false;
+  }
+  const int* kernel_shape_data = this->kernel_shape_.cpu_data();
+  const int* stride_data = this->stride_.cpu_data();
+  const int* dilation_data = this->dilation_.cpu_data();
+  for (int i = 0; i < 2; ++i) {
+    if (dilation_data[i] != 1 || kernel_shape_data[i] % stride_data[i] != 0) {
+      return false;
+    }
+  }
+  return stride_data[0] > 1 || stride_data[1] > 1;
+}
+
+void DeconvolutionLayer::Reshape(const vector<Blob*>& bottom,
+                                 const vector<Blob*>& top) {
+  BaseConvolutionLayer::Reshape(bottom, top);
+  phase_ = UsePhaseKernel();
+  if (!phase_) {
+    return;
+  }
+  // small phases are batched over images to keep the GEMMs wide
+  const int phase_size = MaxPhaseSize();
+  const int taps = PhaseTaps();
+  phase_batch_ = std::min(this->num_, std::max(1, std::min(
+      kPhaseColumns / phase_size, kMaxPhasePanel / (taps * phase_size))));
+  const int out_group = this->num_output_ / this->group_;
+  phase_buffer_.Reshape(
+      vector<int>(1, (taps + out_group) * phase_batch_ * phase_size));
+}
+
+void DeconvolutionLayer::PackPhaseWeights() {
+  const int count = this->blobs_[0]->count();
+  const real_t* weight = this->blobs_[0]->cpu_data();
+  if (phase_source_.count() == count &&
+      std::memcmp(phase_source_.cpu_data(), weight,
+                  count * sizeof(real_t)) == 0) {
+    return;
+  }
+  // kept across forwards like the weights themselves
+  MemArenaScope weight_arena(kWeightArena);
+  phase_source_.Reshape(vector<int>(1, count));
+  caffe_copy(count, weight, phase_source_.mutable_cpu_data());
+  const int kernel_h = this->kernel_shape_.cpu_data()[0];
+  const int kernel_w = this->kernel_shape_.cpu_data()[1];
+  const int stride_h = this->stride_.cpu_data()[0];
+  const int stride_w = this->stride_.cpu_data()[1];
+  const int pad_h = this->pad_.cpu_data()[0];
+  const int pad_w = this->pad_.cpu_data()[1];
+  const int taps_h = kernel_h / stride_h;
+  const int taps_w = kernel_w / stride_w;
+  const int in_group = this->channels_ / this->group_;
+  const int out_group = this->num_output_ / this->group_;
+  phase_weight_.Reshape(vector<int>(1, count));
+  real_t* packed = phase_weight_.mutable_cpu_data();
+  for (int g = 0; g < this->group_; ++g) {
+    for (int ry = 0; ry < stride_h; ++ry) {
+      for (int rx = 0; rx < stride_w; ++rx) {
+        // taps come last to first so the shifted input rows ascend
+        const int ky0 = (ry + pad_h) % stride_h + (taps_h - 1) * stride_h;
+        const int kx0 = (rx + pad_w) % stride_w + (taps_w - 1) * stride_w;
+        for (int oc = 0; oc < out_group; ++oc) {
+          for (int ic = 0; ic < in_group; ++ic) {
+            const real_t* kernel = weight +
+                ((g * in_group + ic) * out_group + oc) * kernel_h * kernel_w;
+            for (int a = 0; a < taps_h; ++a) {
+              for (int b = 0; b < taps_w; ++b) {
+                *packed++ = kernel[(ky0 - a * stride_h) * kernel_w +
+                                   kx0 - b * stride_w];
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+void DeconvolutionLayer::PhaseForward_cpu(const real_t* input,
+                                          const real_t* bias,
+                                          real_t* output, int batch) {
+  const int stride_h = this->stride_.cpu_data()[0];
+  const int stride_w = this->stride_.cpu_data()[1];
+  const int pad_h = this->pad_.cpu_data()[0];
+  const int pad_w = this->pad_.cpu_data()[1];
+  const int taps_h = this->kernel_shape_.cpu_data()[0] / stride_h;
+  const int taps_w = this->kernel_shape_.cpu_data()[1] / stride_w;
+  const int in_h = this->input_shape(1);
+  const int in_w = this->input_shape(2);
+  const int out_h = this->output_shape_[0];
+  const int out_w = this->output_shape_[1];
+  const int in_group = this->channels_ / this->group_;
+  const int out_group = this->num_output_ / this->group_;
+  const int taps = in_group * taps_h * taps_w;
+  const int max_columns = batch * MaxPhaseSize();
+  real_t* col = phase_buffer_.mutable_cpu_data();
+  real_t* result = col + taps * max_columns;
+  const real_t* packed = phase_weight_.cpu_data();
+  for (int g = 0; g < this->group_; ++g) {
+    for (int ry = 0; ry < stride_h; ++ry) {
+      for (int rx = 0; rx < stride_w; ++rx, packed += out_group * taps) {
+        const int qh = (out_h - ry + stride_h - 1) / stride_h;
+        const int qw = (out_w - rx + stride_w - 1) / stride_w;
+        if (qh <= 0 || qw <= 0) {
+          continue;
+        }
+        // image n owns columns [n * qh * qw, (n + 1) * qh * qw), and its
+        // output qy of the phase reads input row qy + dy + a for tap a
+        const int columns = batch * qh * qw;
+        const int dy = (ry + pad_h) / stride_h - (taps_h - 1);
+        const int dx = (rx + pad_w) / stride_w - (taps_w - 1);
+        real_t* col_data = col;
+        for (int ic = 0; ic < in_group; ++ic) {
+          for (int a = 0; a < taps_h; ++a) {
+            for (int b = 0; b < taps_w; ++b) {
+              const int ox = dx + b;
+              const int begin = std::min(qw, std::max(0, -ox));
+              const int end = std::max(begin, std::min(qw, in_w - ox));
+              for (int n = 0; n < batch; ++n) {
+                const real_t* im = input + n * this->bottom_dim_ +
+                                   (g * in_group + ic) * in_h * in_w;
+                for (int qy = 0; qy < qh; ++qy, col_data += qw) {
+                  const int iy = qy + dy + a;
+                  if (iy < 0 || iy >= in_h) {
+                    std::fill(col_data, col_data + qw, real_t(0));
+                    continue;
+                  }
+                  const real_t* src = im + iy * in_w + ox;
+                  std::fill(col_data, col_data + begin, real_t(0));
+                  std::copy(src + begin, src + end, col_data + begin);
+                  std::fill(col_data + end, col_data + qw, real_t(0));
+                }
+              }
+            }
+          }
+        }
+        caffe_cpu_gemm(CblasNoTrans, CblasNoTrans, out_group, columns, taps,
+            static_cast<real_t>(1), packed, col,
+            static_cast<real_t>(0), result);
+        // interleave the phase into the tops, adding the bias
+        const real_t* src = result;
+        for (int oc = 0; oc < out_group; ++oc) {
+          const int channel = g * out_group + oc;
+          const real_t bias_value = bias ? bias[channel] : real_t(0);
+          for (int n = 0; n < batch; ++n) {
+            real_t* dst = output + n * this->top_dim_ +
+                          (channel * out_h + ry) * out_w + rx;
+            for (int qy = 0; qy < qh; ++qy, src += qw) {
+              real_t* row = dst + qy * stride_h * out_w;
+              for (int qx = 0; qx < qw; ++qx) {
+                row[qx * stride_w] = src[qx] + bias_value;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
 void DeconvolutionLayer::Forward_cpu(const vector<Blob*>& bottom,
                                      const vector<Blob*>& top) {
   const real_t* weight = this->blobs_[0]->cpu_data();
+  if (phase_) {
+    PackPhaseWeights();
+  }
   for (int i = 0; i < bottom.size(); ++i) {
     const real_t* bottom_data = bottom[i]->cpu_data();
     real_t* top_data = top[i]->mutable_cpu_data();
+    if (phase_) {
+      const real_t* bias =
+          this->bias_term_ ? this->blobs_[1]->cpu_data() : NULL;
+      for (int n = 0; n < this->num_; n += phase_batch_) {
+        PhaseForward_cpu(bottom_data + n * this->bottom_dim_, bias,
+                         top_data + n * this->top_dim_,
+                         std::min(phase_batch_, this->num_ - n));
+      }
+      continue;
+    }
     for (int n = 0; n < this->num_; ++n) {
       this->backward_cpu_gemm(bottom_data + n * this->bottom_dim_, weight,
           top_data + n * this->top_dim_);
@@ -24,9 +24,15 @@ namespace caffe {
 class DeconvolutionLayer : public BaseConvolutionLayer {
  public:
   explicit DeconvolutionLayer(const LayerParameter& param)
-      : BaseConvolutionLayer(param) {}
+      : BaseConvolutionLayer(param), phase_(false), phase_batch_(0) {}
+  virtual void Reshape(const vector<Blob*>& bottom,
+                       const vector<Blob*>& top);
 
   virtual const char* type() const { return "Deconvolution"; }
+  virtual void ClearInternalBuffer() {
+    BaseConvolutionLayer::ClearInternalBuffer();
+    phase_buffer_.Release();
+  }
 
  protected:
   virtual void Forward_cpu(const vector<Blob*>& bottom,
@@ -35,6 +41,54 @@ class DeconvolutionLayer : public BaseConvolutionLayer {
                            const vector<Blob*>& top);
   virtual bool reverse_dimensions() { return true; }
   virtual void compute_output_shape();
+
+ private:
+  /**
+   * @brief Whether the CPU forward can run phase by phase. This needs 2D,
+   *        no dilation and kernels that are multiples of the strides, so
+   *        every output phase sees kernel / stride taps along each axis,
+   *        and enough output channels per group to keep the GEMMs efficient.
+   */
+  bool UsePhaseKernel();
+  /**
+   * @brief Regroup the weights into one matrix per group and output phase.
+   *        The weights can be written through Net::params() or the C API at
+   *        any time, so they are compared with the ones last packed and only
+   *        packed again when they differ.
+   */
+  void PackPhaseWeights();
+  /**
+   * @brief Sub-pixel forward of batch images. The outputs (ry + stride * qy,
+   *        rx + stride * qx) of a phase (ry, rx) form a plain stride 1
+   *        correlation of the input with its own taps of the kernel, so each
+   *        phase is one GEMM over shifted input rows, whose result is written
+   *        to the tops exactly once, with no column buffer and no col2im.
+   */
+  void PhaseForward_cpu(const real_t* input, const real_t* bias,
+                        real_t* output, int batch);
+  /// @brief taps of every phase matrix row, in_group * taps_h * taps_w
+  int PhaseTaps() {
+    return this->channels_ / this->group_ * this->blobs_[0]->count(2) /
+           (this->stride_.cpu_data()[0] * this->stride_.cpu_data()[1]);
+  }
+  /// @brief outputs of phase (0, 0) in one image, the largest phase
+  int MaxPhaseSize() {
+    const int stride_h = this->stride_.cpu_data()[0];
+    const int stride_w = this->stride_.cpu_data()[1];
+    return ((this->output_shape_[0] + stride_h - 1) / stride_h) *
+           ((this->output_shape_[1] + stride_w - 1) / stride_w);
+  }
+
+  /// whether the CPU forward runs phase by phase, set by Reshape
+  bool phase_;
+  /// images per phase GEMM, set by Reshape
+  int phase_batch_;
+  /// phase matrices of the weights, [group][phase][out channel][tap]
+  Blob phase_weight_;
+  /// copy of the weights phase_weight_ was packed from
+  Blob phase_source_;
+  /// shifted input rows and GEMM result of one phase, sized by Reshape
+  Blob phase_buffer_;
 };
 
 }  // namespace caffe
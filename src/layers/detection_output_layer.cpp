@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "./detection_output_layer.hpp"
+#include "../util/nms.hpp"
+
+namespace caffe {
+
+void DetectionOutputLayer::LayerSetUp(const vector<Blob*>& /*bottom*/,
+                                      const vector<Blob*>& /*top*/) {
+  const DetectionOutputParameter& param =
+      this->layer_param_.detection_output_param();
+  background_label_id_ = param.background_label_id();
+  confidence_threshold_ = param.confidence_threshold();
+  nms_threshold_ = param.nms_threshold();
+  top_k_ = param.top_k();
+  keep_top_k_ = param.keep_top_k();
+}
+
+void DetectionOutputLayer::Reshape(const vector<Blob*>& bottom,
+                                   const vector<Blob*>& top) {
+  CHECK_EQ(bottom[0]->count(1), 5) << "rois should be (R, 5).";
+  CHECK_EQ(bottom[1]->shape(0), bottom[0]->shape(0))
+      << "Every roi needs its class scores.";
+  if (bottom.size() > 2) {
+    CHECK_EQ(bottom[2]->count(), 3)
+        << "im_info should be (height, width, scale).";
+  }
+  if (bottom.size() > 3) {
+    const int num_classes = bottom[1]->count(1);
+    const int delta_dim = bottom[3]->count(1);
+    CHECK_EQ(bottom[3]->shape(0), bottom[0]->shape(0))
+        << "Every roi needs its box deltas.";
+    CHECK(delta_dim == 4 || delta_dim == 8 || delta_dim == 4 * num_classes)
+        << "Box deltas should be (R, 4), (R, 8) or (R, 4C).";
+  }
+  // the number of detections is only known after NMS, Forward reshapes again
+  top[0]->Reshape(vector<int>{1, 7});
+}
+
+void DetectionOutputLayer::Forward_cpu(const vector<Blob*>& bottom,
+                                       const vector<Blob*>& top) {
+  const int num_rois = bottom[0]->shape(0);
+  const int num_classes = bottom[1]->count(1);
+  if (num_rois == 0) {
+    top[0]->Reshape(vector<int>{0, 7});
+    return;
+  }
+  const real_t* rois = bottom[0]->cpu_data();
+  const real_t* scores = bottom[1]->cpu_data();
+  const bool clip = bottom.size() > 2;
+  real_t max_x = 0, max_y = 0, scale = 1;
+  if (clip) {
+    const real_t* im_info = bottom[2]->cpu_data();
+    max_y = im_info[0] - 1;
+    max_x = im_info[1] - 1;
+    scale = im_info[2];
+  }
+  const real_t* deltas = bottom.size() > 3 ? bottom[3]->cpu_data() : NULL;
+  const int delta_dim = deltas ? bottom[3]->count(1) : 0;
+  int num_images = 0;
+  for (int i = 0; i < num_rois; ++i) {
+    num_images = std::max(num_images, static_cast<int>(rois[5 * i]) + 1);
+  }
+  vector<real_t> detections, image_detections;
+  vector<int> candidates;
+  vector<real_t> boxes, candidate_scores;
+  for (int n = 0; n < num_images; ++n) {
+    image_detections.clear();
+    for (int c = 0; c < num_classes; ++c) {
+      if (c == background_label_id_) {
+        continue;
+      }
+      // most rois score low on most classes, so they are dropped before any
+      // box is decoded or sorted
+      candidates.clear();
+      for (int i = 0; i < num_rois; ++i) {
+        if (scores[i * num_classes + c] > confidence_threshold_ &&
+            static_cast<int>(rois[5 * i]) == n) {
+          candidates.push_back(i);
+        }
+      }
+      const int num = candidates.size();
+      if (num == 0) {
+        continue;
+      }
+      boxes.resize(4 * num);
+      candidate_scores.resize(num);
+      const int delta_offset = delta_dim == 4 * num_classes ? 4 * c
+                                                            : delta_dim - 4;
+      for (int k = 0; k < num; ++k) {
+        const int i = candidates[k];
+        const real_t* roi = rois + 5 * i + 1;
+        real_t* box = &boxes[4 * k];
+        if (deltas) {
+          const real_t* delta = deltas + i * delta_dim + delta_offset;
+          const real_t w = roi[2] - roi[0] + 1;
+          const real_t h = roi[3] - roi[1] + 1;
+          const real_t center_x = delta[0] * w + roi[0] + 0.5f * w;
+          const real_t center_y = delta[1] * h + roi[1] + 0.5f * h;
+          const real_t pred_w = std::exp(delta[2]) * w;
+          const real_t pred_h = std::exp(delta[3]) * h;
+          box[0] = center_x - 0.5f * pred_w;
+          box[1] = center_y - 0.5f * pred_h;
+          box[2] = center_x + 0.5f * pred_w;
+          box[3] = center_y + 0.5f * pred_h;
+        }
+        else {
+          std::copy(roi, roi + 4, box);
+        }
+        if (clip) {
+          box[0] = std::max<real_t>(0, std::min(box[0], max_x));
+          box[1] = std::max<real_t>(0, std::min(box[1], max_y));
+          box[2] = std::max<real_t>(0, std::min(box[2], max_x));
+          box[3] = std::max<real_t>(0, std::min(box[3], max_y));
+        }
+        candidate_scores[k] = scores[i * num_classes + c];
+      }
+      const vector<int> order = SortByScore(&candidate_scores[0], num, 1,
+                                            top_k_);
+      const vector<int> keep = NonMaximumSuppression(&boxes[0], 4, order,
+                                                     nms_threshold_, 0, 1);
+      for (int k : keep) {
+        image_detections.push_back(n);
+        image_detections.push_back(c);
+        image_detections.push_back(candidate_scores[k]);
+        for (int j = 0; j < 4; ++j) {
+          image_detections.push_back(boxes[4 * k + j] / scale);
+        }
+      }
+    }
+    // best detections of the image over all classes come first
+    const int num = image_detections.size() / 7;
+    if (num == 0) {
+      continue;
+    }
+    const vector<int> order = SortByScore(&image_detections[2], num, 7,
+                                          keep_top_k_);
+    for (int k : order) {
+      detections.insert(detections.end(), &image_detections[7 * k],
+                        &image_detections[7 * k] + 7);
+    }
+  }
+  const int num_detections = detections.size() / 7;
+  top[0]->Reshape(vector<int>{num_detections, 7});
+  if (num_detections > 0) {
+    std::copy(detections.begin(), detections.end(),
+              top[0]->mutable_cpu_data());
+  }
+}
+
+REGISTER_LAYER_CLASS(DetectionOutput);
+
+}  // namespace caffe
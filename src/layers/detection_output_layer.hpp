@@ -0,0 +1,65 @@
+#ifndef CAFFE_DETECTION_OUTPUT_LAYER_HPP_
+#define CAFFE_DETECTION_OUTPUT_LAYER_HPP_
+
+#include <vector>
+
+#include "../layer.hpp"
+
+namespace caffe {
+
+/**
+ * @brief Turns the rois and class scores of a detector into final
+ *        detections, the post processing of Fast R-CNN style detectors.
+ *
+ * For every image and every class but the background, rois scoring above
+ * confidence_threshold are moved by their box deltas, clipped to the image,
+ * sorted by score and filtered by NMS. At most keep_top_k detections of an
+ * image are returned, best first, in the original image coordinates.
+ *
+ * NOTE: does not implement Backwards operation.
+ */
+class DetectionOutputLayer : public Layer {
+ public:
+  explicit DetectionOutputLayer(const LayerParameter& param)
+      : Layer(param) {}
+  virtual void LayerSetUp(const vector<Blob*>& bottom,
+                          const vector<Blob*>& top);
+  virtual void Reshape(const vector<Blob*>& bottom,
+                       const vector<Blob*>& top);
+
+  virtual const char* type() const { return "DetectionOutput"; }
+  virtual int MinBottomBlobs() const { return 2; }
+  virtual int MaxBottomBlobs() const { return 4; }
+  virtual int ExactNumTopBlobs() const { return 1; }
+
+ protected:
+  /**
+   * @param bottom input Blob vector (length 2 to 4)
+   *   -# @f$ (R \times 5) @f$
+   *      rois as (batch index, x1, y1, x2, y2)
+   *   -# @f$ (R \times C) @f$
+   *      class scores of every roi
+   *   -# @f$ (1 \times 3) @f$
+   *      image height, width and the scale it was resized by, optional.
+   *      Boxes are clipped to the image and divided by the scale
+   *   -# @f$ (R \times 4) @f$, @f$ (R \times 8) @f$ or
+   *      @f$ (R \times 4C) @f$
+   *      box deltas (dx, dy, dw, dh), shared by all classes, class agnostic
+   *      (background then object) or per class, optional
+   * @param top output Blob vector (length 1)
+   *   -# @f$ (K \times 7) @f$
+   *      detections as (batch index, label, score, x1, y1, x2, y2)
+   */
+  virtual void Forward_cpu(const vector<Blob*>& bottom,
+                           const vector<Blob*>& top);
+
+  int background_label_id_;
+  real_t confidence_threshold_;
+  real_t nms_threshold_;
+  int top_k_;
+  int keep_top_k_;
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_DETECTION_OUTPUT_LAYER_HPP_
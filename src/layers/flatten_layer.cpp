@@ -1,6 +1,7 @@
 #include <vector>
 
 #include "./flatten_layer.hpp"
+#include "../util/math_functions.hpp"
 
 namespace caffe {
 
@@ -27,6 +28,12 @@ void FlattenLayer::Reshape(const vector<Blob*>& bottom,
 
 void FlattenLayer::Forward_cpu(const vector<Blob*>& bottom,
                                const vector<Blob*>& top) {
+  // memory bound by the caller must be written, not replaced
+  if (top[0]->external_data()) {
+    caffe_copy(top[0]->count(), bottom[0]->cpu_data(),
+               top[0]->mutable_cpu_data());
+    return;
+  }
   top[0]->ShareData(*bottom[0]);
 }
 
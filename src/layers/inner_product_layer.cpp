@@ -82,13 +82,27 @@ void InnerProductLayer::Forward_cpu(const vector<Blob*>& bottom,
   const real_t* bottom_data = bottom[0]->cpu_data();
   real_t* top_data = top[0]->mutable_cpu_data();
   const real_t* weight = this->blobs_[0]->cpu_data();
-  caffe_cpu_gemm(CblasNoTrans, transpose_ ? CblasNoTrans : CblasTrans,
-    M_, N_, K_, static_cast<real_t>(1),
-    bottom_data, weight, static_cast<real_t>(0), top_data);
+  // the bias goes into the top first and the product accumulates onto it,
+  // which saves the rank 1 GEMM over bias_multiplier_
+  real_t beta = 0;
   if (bias_term_) {
-    caffe_cpu_gemm(CblasNoTrans, CblasNoTrans, M_, N_, 1, static_cast<real_t>(1),
-      bias_multiplier_.cpu_data(),
-      this->blobs_[1]->cpu_data(), static_cast<real_t>(1), top_data);
+    const real_t* bias = this->blobs_[1]->cpu_data();
+    for (int m = 0; m < M_; ++m) {
+      caffe_copy(N_, bias, top_data + m * N_);
+    }
+    beta = 1;
+  }
+  if (M_ == 1) {
+    // a single row is a matrix vector product, both weight layouts are read
+    // once front to back
+    caffe_cpu_gemv(transpose_ ? CblasTrans : CblasNoTrans,
+      transpose_ ? K_ : N_, transpose_ ? N_ : K_, static_cast<real_t>(1),
+      weight, bottom_data, beta, top_data);
+  }
+  else {
+    caffe_cpu_gemm(CblasNoTrans, transpose_ ? CblasNoTrans : CblasTrans,
+      M_, N_, K_, static_cast<real_t>(1),
+      bottom_data, weight, beta, top_data);
   }
 }
 
@@ -12,6 +12,12 @@ void InputLayer::LayerSetUp(const vector<Blob*>& bottom,
   CHECK(num_shape == 0 || num_shape == 1 || num_shape == num_top)
       << "Must specify 'shape' once, once per top blob, or not at all: "
       << num_top << " tops vs. " << num_shape << " shapes.";
+  const TransformationParameter& transform =
+      this->layer_param_.transform_param();
+  CHECK(!transform.has_mean_file() && !transform.mirror() &&
+        transform.crop_size() == 0)
+      << "Input only supports mean_value, scale and channel_swap of "
+      << "transform_param.";
   if (num_shape > 0) {
     for (int i = 0; i < num_top; ++i) {
       const int shape_index = (param.shape_size() == 1) ? 0 : i;
@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 
 #include "./lrn_layer.hpp"
@@ -10,6 +14,9 @@
 
 namespace caffe {
 
+// channels of a tile of kTile pixels are normalized together
+static const int kTile = 256;
+
 void LRNLayer::LayerSetUp(const vector<Blob*>& bottom,
                           const vector<Blob*>& top) {
   size_ = this->layer_param_.lrn_param().local_size();
@@ -81,8 +88,10 @@ void LRNLayer::Reshape(const vector<Blob*>& bottom,
   case LRNParameter_NormRegion_ACROSS_CHANNELS:
     top[0]->Reshape(num_, channels_, height_, width_);
     scale_.Reshape(num_, channels_, height_, width_);
+    window_.resize(size_ * kTile);
     break;
   case LRNParameter_NormRegion_WITHIN_CHANNEL:
+    window_.resize((size_ + 2) * width_);
     split_layer_->Reshape(bottom, split_top_vec_);
     square_layer_->Reshape(square_bottom_vec_, square_top_vec_);
     pool_layer_->Reshape(square_top_vec_, pool_top_vec_);
@@ -99,57 +108,171 @@ void LRNLayer::Forward_cpu(const vector<Blob*>& bottom,
     CrossChannelForward_cpu(bottom, top);
     break;
   case LRNParameter_NormRegion_WITHIN_CHANNEL:
-    WithinChannelForward(bottom, top);
+    WithinChannelForward_cpu(bottom, top);
     break;
   default:
     LOG(FATAL) << "Unknown normalization region.";
   }
 }
 
+/*!
+ * \brief 1 / sqrt(x) for x > 0, Newton iterations from an estimate made
+ *  of the exponent bits. It has no branch or call, unlike std::sqrt which
+ *  may set errno, so loops over it are vectorized.
+ */
+static inline float RSqrt(float x) {
+  int32_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  bits = 0x5f375a86 - (bits >> 1);
+  float r;
+  std::memcpy(&r, &bits, sizeof(r));
+  const float half = 0.5f * x;
+  r = r * (1.5f - half * r * r);
+  r = r * (1.5f - half * r * r);
+  r = r * (1.5f - half * r * r);
+  return r;
+}
+
+/*!
+ * \brief y = x * scale^-beta, scale is positive. The powers used by
+ *  AlexNet and GoogLeNet style models are built from RSqrt.
+ */
+static void ScaleByPower(const int n, const real_t* x, const real_t* scale,
+                         const real_t beta, real_t* y) {
+  if (beta == 0.75f) {
+    for (int i = 0; i < n; ++i) {
+      const real_t r = RSqrt(scale[i]);  // scale^-1/2
+      y[i] = x[i] * r * r * RSqrt(r);
+    }
+  }
+  else if (beta == 0.5f) {
+    for (int i = 0; i < n; ++i) {
+      y[i] = x[i] * RSqrt(scale[i]);
+    }
+  }
+  else if (beta == 1.f) {
+    for (int i = 0; i < n; ++i) {
+      y[i] = x[i] / scale[i];
+    }
+  }
+  else {
+    for (int i = 0; i < n; ++i) {
+      y[i] = x[i] * std::pow(scale[i], -beta);
+    }
+  }
+}
+
 void LRNLayer::CrossChannelForward_cpu(const vector<Blob*>& bottom,
                                        const vector<Blob*>& top) {
   const real_t* bottom_data = bottom[0]->cpu_data();
   real_t* top_data = top[0]->mutable_cpu_data();
-  real_t* scale_data = scale_.mutable_cpu_data();
-  // start with the constant value
-  for (int i = 0; i < scale_.count(); ++i) {
-    scale_data[i] = k_;
-  }
-  Blob padded_square(1, channels_ + size_ - 1, height_, width_);
-  real_t* padded_square_data = padded_square.mutable_cpu_data();
-  caffe_set(padded_square.count(), static_cast<real_t>(0), padded_square_data);
-  real_t alpha_over_size = alpha_ / size_;
-  // go through the images
+  const int spatial = height_ * width_;
+  const int post_pad = size_ - pre_pad_ - 1;
+  const real_t alpha_over_size = alpha_ / size_;
+  // squares of the last size_ channels of the tile, channel c lives in row
+  // c % size_, so top may be the same memory as bottom
+  real_t* ring = window_.data();
+  real_t accum[kTile];
+  real_t scale[kTile];
   for (int n = 0; n < num_; ++n) {
-    // compute the padded square
-    caffe_sqr(channels_ * height_ * width_,
-        bottom_data + bottom[0]->offset(n),
-        padded_square_data + padded_square.offset(0, pre_pad_));
-    // Create the first channel scale
-    for (int c = 0; c < size_; ++c) {
-      caffe_axpy(height_ * width_, alpha_over_size,
-        padded_square_data + padded_square.offset(0, c),
-        scale_data + scale_.offset(n, 0));
-    }
-    for (int c = 1; c < channels_; ++c) {
-      // copy previous scale
-      caffe_copy(height_ * width_,
-        scale_data + scale_.offset(n, c - 1),
-        scale_data + scale_.offset(n, c));
-      // add head
-      caffe_axpy(height_ * width_, alpha_over_size,
-        padded_square_data + padded_square.offset(0, c + size_ - 1),
-        scale_data + scale_.offset(n, c));
-      // subtract tail
-      caffe_axpy(height_ * width_, -alpha_over_size,
-        padded_square_data + padded_square.offset(0, c - 1),
-        scale_data + scale_.offset(n, c));
+    for (int k0 = 0; k0 < spatial; k0 += kTile) {
+      const int len = std::min(kTile, spatial - k0);
+      const real_t* x = bottom_data + bottom[0]->offset(n) + k0;
+      real_t* y = top_data + top[0]->offset(n) + k0;
+      std::fill(accum, accum + len, static_cast<real_t>(0));
+      for (int c = 0; c < std::min(post_pad, channels_); ++c) {
+        const real_t* xc = x + c * spatial;
+        real_t* sq = ring + (c % size_) * kTile;
+        for (int k = 0; k < len; ++k) {
+          sq[k] = xc[k] * xc[k];
+          accum[k] += sq[k];
+        }
+      }
+      // slide the window [c - pre_pad_, c + post_pad] along channels, the
+      // channel leaving it shares its ring row with the one entering it
+      for (int c = 0; c < channels_; ++c) {
+        const int head = c + post_pad;
+        const int tail = c - pre_pad_ - 1;
+        if (tail >= 0) {
+          const real_t* sq = ring + (tail % size_) * kTile;
+          for (int k = 0; k < len; ++k) {
+            accum[k] -= sq[k];
+          }
+        }
+        if (head < channels_) {
+          const real_t* xh = x + head * spatial;
+          real_t* sq = ring + (head % size_) * kTile;
+          for (int k = 0; k < len; ++k) {
+            sq[k] = xh[k] * xh[k];
+            accum[k] += sq[k];
+          }
+        }
+        for (int k = 0; k < len; ++k) {
+          scale[k] = k_ + alpha_over_size * accum[k];
+        }
+        ScaleByPower(len, x + c * spatial, scale, beta_, y + c * spatial);
+      }
     }
   }
+}
 
-  // In the end, compute output
-  caffe_powx(scale_.count(), scale_data, -beta_, top_data);
-  caffe_mul(scale_.count(), top_data, bottom_data, top_data);
+void LRNLayer::WithinChannelForward_cpu(const vector<Blob*>& bottom,
+                                        const vector<Blob*>& top) {
+  const real_t* bottom_data = bottom[0]->cpu_data();
+  real_t* top_data = top[0]->mutable_cpu_data();
+  const int post_pad = size_ - pre_pad_ - 1;
+  // the average of the padded size_ x size_ window, as the pooling sub
+  // layer computes it
+  const real_t alpha_over_area = alpha_ / (size_ * size_);
+  // squared rows of the window, row h lives in ring row h % size_, then
+  // the column sums of the window and the scale of an output row
+  real_t* ring = window_.data();
+  real_t* column = ring + size_ * width_;
+  real_t* scale = column + width_;
+  for (int n = 0; n < num_; ++n) {
+    for (int c = 0; c < channels_; ++c) {
+      const real_t* x = bottom_data + bottom[0]->offset(n, c);
+      real_t* y = top_data + top[0]->offset(n, c);
+      std::fill(column, column + width_, static_cast<real_t>(0));
+      for (int h = 0; h < std::min(post_pad, height_); ++h) {
+        const real_t* xh = x + h * width_;
+        real_t* sq = ring + (h % size_) * width_;
+        for (int w = 0; w < width_; ++w) {
+          sq[w] = xh[w] * xh[w];
+          column[w] += sq[w];
+        }
+      }
+      for (int h = 0; h < height_; ++h) {
+        const int head = h + post_pad;
+        const int tail = h - pre_pad_ - 1;
+        if (tail >= 0) {
+          const real_t* sq = ring + (tail % size_) * width_;
+          for (int w = 0; w < width_; ++w) {
+            column[w] -= sq[w];
+          }
+        }
+        if (head < height_) {
+          const real_t* xh = x + head * width_;
+          real_t* sq = ring + (head % size_) * width_;
+          for (int w = 0; w < width_; ++w) {
+            sq[w] = xh[w] * xh[w];
+            column[w] += sq[w];
+          }
+        }
+        // running sum of column sums along the row
+        real_t sum = 0;
+        for (int w = 0; w < std::min(post_pad, width_); ++w) {
+          sum += column[w];
+        }
+        for (int w = 0; w < width_; ++w) {
+          if (w + post_pad < width_) sum += column[w + post_pad];
+          if (w - pre_pad_ - 1 >= 0) sum -= column[w - pre_pad_ - 1];
+          scale[w] = 1 + alpha_over_area * sum;
+        }
+        ScaleByPower(width_, x + h * width_, scale, beta_, y + h * width_);
+      }
+    }
+  }
 }
 
 void LRNLayer::WithinChannelForward(const vector<Blob*>& bottom,
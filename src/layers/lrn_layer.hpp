@@ -38,6 +38,9 @@ class LRNLayer : public Layer {
                                        const vector<Blob*>& top);
   virtual void CrossChannelForward_gpu(const vector<Blob*>& bottom,
                                        const vector<Blob*>& top);
+  virtual void WithinChannelForward_cpu(const vector<Blob*>& bottom,
+                                        const vector<Blob*>& top);
+  /// runs the sub layers below, used on GPU
   virtual void WithinChannelForward(const vector<Blob*>& bottom,
                                     const vector<Blob*>& top);
 
@@ -52,9 +55,13 @@ class LRNLayer : public Layer {
   int width_;
 
   // Fields used for normalization ACROSS_CHANNELS
-  // scale_ stores the intermediate summing results
+  // scale_ stores the intermediate summing results on GPU
   Blob scale_;
 
+  // squared inputs in the sliding window and partial sums of the CPU
+  // kernels, sized in Reshape so forward never allocates
+  vector<real_t> window_;
+
   // Fields used for normalization WITHIN_CHANNEL
   shared_ptr<SplitLayer> split_layer_;
   vector<Blob*> split_top_vec_;
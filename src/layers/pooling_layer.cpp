@@ -110,12 +110,175 @@ void PoolingLayer::Reshape(const vector<Blob*>& bottom,
   if (top.size() > 1) {
     top[1]->ReshapeLike(*top[0]);
   }
+  // pick the CPU kernel, anything without a specialized one runs the
+  // generic loop below
+  cpu_kernel_ = kGenericKernel;
+  if (kernel_h_ == height_ && kernel_w_ == width_ &&
+      pad_h_ == 0 && pad_w_ == 0) {
+    cpu_kernel_ = kGlobalKernel;
+  }
+  else if (kernel_h_ == kernel_w_ && stride_h_ == stride_w_) {
+    if (kernel_h_ == 2 && stride_h_ == 2) {
+      cpu_kernel_ = kWindow2x2S2Kernel;
+    }
+    else if (kernel_h_ == 3 && stride_h_ == 2) {
+      cpu_kernel_ = kWindow3x3S2Kernel;
+    }
+    else if (kernel_h_ == 3 && stride_h_ == 1) {
+      cpu_kernel_ = kWindow3x3S1Kernel;
+    }
+  }
+  if (cpu_kernel_ != kGenericKernel && cpu_kernel_ != kGlobalKernel) {
+    row_buffer_.resize(width_);
+  }
+}
+
+template<int kSize, int kStride>
+void PoolingLayer::WindowForward_cpu(const vector<Blob*>& bottom,
+                                     const vector<Blob*>& top) {
+  const bool is_max = this->layer_param_.pooling_param().pool() ==
+                      PoolingParameter_PoolMethod_MAX;
+  const real_t* bottom_data = bottom[0]->cpu_data();
+  real_t* top_data = top[0]->mutable_cpu_data();
+  const int planes = bottom[0]->num() * channels_;
+  // outputs in [pw_begin, pw_end) have the whole window inside the row
+  const int pw_begin = min((pad_w_ + kStride - 1) / kStride, pooled_width_);
+  const int pw_end = width_ + pad_w_ < kSize ? pw_begin :
+      max(pw_begin, min((width_ + pad_w_ - kSize) / kStride + 1,
+                        pooled_width_));
+  real_t* row = row_buffer_.data();
+  for (int i = 0; i < planes; ++i) {
+    for (int ph = 0; ph < pooled_height_; ++ph) {
+      const int hstart = ph * stride_h_ - pad_h_;
+      const int hend = min(hstart + kSize, height_);
+      // reduce the rows of the window into one row
+      const real_t* x = bottom_data + max(hstart, 0) * width_;
+      std::copy(x, x + width_, row);
+      for (int h = max(hstart, 0) + 1; h < hend; ++h) {
+        x = bottom_data + h * width_;
+        if (is_max) {
+          for (int w = 0; w < width_; ++w) {
+            row[w] = x[w] > row[w] ? x[w] : row[w];
+          }
+        }
+        else {
+          for (int w = 0; w < width_; ++w) {
+            row[w] += x[w];
+          }
+        }
+      }
+      real_t* y = top_data + ph * pooled_width_;
+      if (is_max) {
+        for (int pw = pw_begin; pw < pw_end; ++pw) {
+          const real_t* r = row + pw * kStride - pad_w_;
+          real_t val = r[0];
+          for (int k = 1; k < kSize; ++k) {
+            val = r[k] > val ? r[k] : val;
+          }
+          y[pw] = val;
+        }
+      }
+      else {
+        const int hsize = min(hstart + kSize, height_ + pad_h_) - hstart;
+        const real_t scale = static_cast<real_t>(1) / (hsize * kSize);
+        for (int pw = pw_begin; pw < pw_end; ++pw) {
+          const real_t* r = row + pw * kStride - pad_w_;
+          real_t sum = r[0];
+          for (int k = 1; k < kSize; ++k) {
+            sum += r[k];
+          }
+          y[pw] = sum * scale;
+        }
+      }
+      // outputs whose window is clipped by the left or right border
+      for (int pw = 0; pw < pooled_width_; ++pw) {
+        if (pw == pw_begin) pw = pw_end;
+        if (pw >= pooled_width_) break;
+        const int wstart = pw * kStride - pad_w_;
+        const int wend = min(wstart + kSize, width_);
+        real_t val = row[max(wstart, 0)];
+        for (int w = max(wstart, 0) + 1; w < wend; ++w) {
+          val = is_max ? max(val, row[w]) : val + row[w];
+        }
+        if (!is_max) {
+          const int hsize = min(hstart + kSize, height_ + pad_h_) - hstart;
+          const int wsize = min(wstart + kSize, width_ + pad_w_) - wstart;
+          val /= hsize * wsize;
+        }
+        y[pw] = val;
+      }
+    }
+    bottom_data += height_ * width_;
+    top_data += pooled_height_ * pooled_width_;
+  }
+}
+
+void PoolingLayer::GlobalForward_cpu(const vector<Blob*>& bottom,
+                                     const vector<Blob*>& top) {
+  const bool is_max = this->layer_param_.pooling_param().pool() ==
+                      PoolingParameter_PoolMethod_MAX;
+  const real_t* bottom_data = bottom[0]->cpu_data();
+  real_t* top_data = top[0]->mutable_cpu_data();
+  const int planes = bottom[0]->num() * channels_;
+  const int spatial = height_ * width_;
+  // independent partial results in kLanes lanes let the compiler
+  // vectorize the reduction without reordering a single sum
+  const int kLanes = 8;
+  real_t acc[kLanes];
+  for (int i = 0; i < planes; ++i) {
+    const real_t* x = bottom_data + i * spatial;
+    std::fill(acc, acc + kLanes, is_max ? x[0] : static_cast<real_t>(0));
+    int j = 0;
+    if (is_max) {
+      for (; j + kLanes <= spatial; j += kLanes) {
+        for (int l = 0; l < kLanes; ++l) {
+          acc[l] = x[j + l] > acc[l] ? x[j + l] : acc[l];
+        }
+      }
+    }
+    else {
+      for (; j + kLanes <= spatial; j += kLanes) {
+        for (int l = 0; l < kLanes; ++l) {
+          acc[l] += x[j + l];
+        }
+      }
+    }
+    real_t val = acc[0];
+    for (int l = 1; l < kLanes; ++l) {
+      val = is_max ? max(val, acc[l]) : val + acc[l];
+    }
+    for (; j < spatial; ++j) {
+      val = is_max ? max(val, x[j]) : val + x[j];
+    }
+    top_data[i] = is_max ? val : val / spatial;
+  }
 }
 
 // TODO(Yangqing): Is there a faster way to do pooling in the channel-first
 // case?
 void PoolingLayer::Forward_cpu(const vector<Blob*>& bottom,
                                const vector<Blob*>& top) {
+  const PoolingParameter_PoolMethod pool =
+      this->layer_param_.pooling_param().pool();
+  if (pool == PoolingParameter_PoolMethod_MAX ||
+      pool == PoolingParameter_PoolMethod_AVE) {
+    switch (cpu_kernel_) {
+    case kGlobalKernel:
+      GlobalForward_cpu(bottom, top);
+      return;
+    case kWindow2x2S2Kernel:
+      WindowForward_cpu<2, 2>(bottom, top);
+      return;
+    case kWindow3x3S2Kernel:
+      WindowForward_cpu<3, 2>(bottom, top);
+      return;
+    case kWindow3x3S1Kernel:
+      WindowForward_cpu<3, 1>(bottom, top);
+      return;
+    default:
+      break;
+    }
+  }
   const real_t* bottom_data = bottom[0]->cpu_data();
   real_t* top_data = top[0]->mutable_cpu_data();
   const int top_count = top[0]->count();
@@ -123,7 +286,7 @@ void PoolingLayer::Forward_cpu(const vector<Blob*>& bottom,
   const int top_offset = top[0]->offset(0, 1);
   // Different pooling methods. We explicitly do the switch outside the for
   // loop to save time, although this results in more code.
-  switch (this->layer_param_.pooling_param().pool()) {
+  switch (pool) {
   case PoolingParameter_PoolMethod_MAX:
     // The main loop
     for (int n = 0; n < bottom[0]->num(); ++n) {
@@ -36,6 +36,22 @@ class PoolingLayer : public Layer {
                            const vector<Blob*>& top);
   virtual void Forward_gpu(const vector<Blob*>& bottom,
                            const vector<Blob*>& top);
+  /// square windows of common sizes, the window is unrolled
+  template<int kSize, int kStride>
+  void WindowForward_cpu(const vector<Blob*>& bottom,
+                         const vector<Blob*>& top);
+  /// one output per channel, reduction over the whole plane
+  void GlobalForward_cpu(const vector<Blob*>& bottom,
+                         const vector<Blob*>& top);
+
+  /// CPU kernels, picked in Reshape
+  enum CPUKernel {
+    kGenericKernel,
+    kGlobalKernel,
+    kWindow2x2S2Kernel,
+    kWindow3x3S2Kernel,
+    kWindow3x3S1Kernel,
+  };
 
   int kernel_h_, kernel_w_;
   int stride_h_, stride_w_;
@@ -44,6 +60,9 @@ class PoolingLayer : public Layer {
   int height_, width_;
   int pooled_height_, pooled_width_;
   bool global_pooling_;
+  CPUKernel cpu_kernel_;
+  /// input rows reduced along the window height, used by window kernels
+  vector<real_t> row_buffer_;
 };
 
 }  // namespace caffe
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "./proposal_layer.hpp"
+#include "../util/nms.hpp"
+
+namespace caffe {
+
+void ProposalLayer::LayerSetUp(const vector<Blob*>& /*bottom*/,
+                               const vector<Blob*>& /*top*/) {
+  const ProposalParameter& param = this->layer_param_.proposal_param();
+  feat_stride_ = param.feat_stride();
+  min_size_ = param.min_size();
+  pre_nms_topn_ = param.pre_nms_topn();
+  post_nms_topn_ = param.post_nms_topn();
+  nms_thresh_ = param.nms_thresh();
+  CHECK_GT(feat_stride_, 0) << "feat_stride must be positive.";
+  vector<real_t> ratios(param.ratio().begin(), param.ratio().end());
+  vector<real_t> scales(param.scale().begin(), param.scale().end());
+  if (ratios.empty()) {
+    ratios = {0.5f, 1.f, 2.f};
+  }
+  if (scales.empty()) {
+    scales = {8.f, 16.f, 32.f};
+  }
+  // generate_anchors of py-faster-rcnn, the base anchor takes every ratio
+  // keeping its area, with sides rounded half to even, then every scale
+  const real_t base_size = param.base_size();
+  const real_t center = 0.5f * (base_size - 1);
+  anchors_.clear();
+  for (size_t i = 0; i < ratios.size(); ++i) {
+    CHECK_GT(ratios[i], 0) << "ratio must be positive.";
+    const real_t ratio_w = std::nearbyint(
+        std::sqrt(base_size * base_size / ratios[i]));
+    const real_t ratio_h = std::nearbyint(ratio_w * ratios[i]);
+    for (size_t j = 0; j < scales.size(); ++j) {
+      const real_t w = ratio_w * scales[j];
+      const real_t h = ratio_h * scales[j];
+      anchors_.push_back(center - 0.5f * (w - 1));
+      anchors_.push_back(center - 0.5f * (h - 1));
+      anchors_.push_back(center + 0.5f * (w - 1));
+      anchors_.push_back(center + 0.5f * (h - 1));
+    }
+  }
+}
+
+void ProposalLayer::Reshape(const vector<Blob*>& /*bottom*/,
+                            const vector<Blob*>& top) {
+  // the number of rois is only known after NMS, Forward reshapes again
+  top[0]->Reshape(vector<int>{1, 5});
+  if (top.size() > 1) {
+    top[1]->Reshape(vector<int>{1, 1});
+  }
+}
+
+void ProposalLayer::Forward_cpu(const vector<Blob*>& bottom,
+                                const vector<Blob*>& top) {
+  const int num_anchors = anchors_.size() / 4;
+  CHECK_EQ(bottom[0]->shape(0), 1) << "Proposal only supports one image.";
+  CHECK_EQ(bottom[0]->shape(1), 2 * num_anchors)
+      << "Scores need a background and a foreground map per anchor.";
+  CHECK_EQ(bottom[1]->shape(1), 4 * num_anchors)
+      << "Box deltas need four maps per anchor.";
+  CHECK_EQ(bottom[2]->count(), 3)
+      << "im_info should be (height, width, scale).";
+  const int height = bottom[0]->shape(2);
+  const int width = bottom[0]->shape(3);
+  const int spatial = height * width;
+  const real_t* fg_scores = bottom[0]->cpu_data() + num_anchors * spatial;
+  const real_t* deltas = bottom[1]->cpu_data();
+  const real_t* im_info = bottom[2]->cpu_data();
+  const real_t max_x = im_info[1] - 1;
+  const real_t max_y = im_info[0] - 1;
+  const real_t min_size = min_size_ * im_info[2];
+  const int count = num_anchors * spatial;
+  proposals_.Reshape(vector<int>{count, 4});
+  scores_.Reshape(vector<int>(1, count));
+  real_t* boxes = proposals_.mutable_cpu_data();
+  real_t* scores = scores_.mutable_cpu_data();
+  // proposals are enumerated as (h, w, anchor) like py-faster-rcnn, and only
+  // those large enough are stored
+  int num = 0;
+  for (int h = 0; h < height; ++h) {
+    for (int w = 0; w < width; ++w) {
+      const int position = h * width + w;
+      for (int a = 0; a < num_anchors; ++a) {
+        const real_t* anchor = &anchors_[4 * a];
+        const real_t x1 = anchor[0] + w * feat_stride_;
+        const real_t y1 = anchor[1] + h * feat_stride_;
+        const real_t anchor_w = anchor[2] - anchor[0] + 1;
+        const real_t anchor_h = anchor[3] - anchor[1] + 1;
+        const real_t* delta = deltas + 4 * a * spatial + position;
+        const real_t center_x = delta[0] * anchor_w + x1 + 0.5f * anchor_w;
+        const real_t center_y =
+            delta[spatial] * anchor_h + y1 + 0.5f * anchor_h;
+        const real_t pred_w = std::exp(delta[2 * spatial]) * anchor_w;
+        const real_t pred_h = std::exp(delta[3 * spatial]) * anchor_h;
+        real_t* box = boxes + 4 * num;
+        box[0] = std::max<real_t>(0, std::min(center_x - 0.5f * pred_w,
+                                              max_x));
+        box[1] = std::max<real_t>(0, std::min(center_y - 0.5f * pred_h,
+                                              max_y));
+        box[2] = std::max<real_t>(0, std::min(center_x + 0.5f * pred_w,
+                                              max_x));
+        box[3] = std::max<real_t>(0, std::min(center_y + 0.5f * pred_h,
+                                              max_y));
+        if (box[2] - box[0] + 1 >= min_size &&
+            box[3] - box[1] + 1 >= min_size) {
+          scores[num++] = fg_scores[a * spatial + position];
+        }
+      }
+    }
+  }
+  const vector<int> order = SortByScore(scores, num, 1, pre_nms_topn_);
+  const vector<int> keep = NonMaximumSuppression(boxes, 4, order, nms_thresh_,
+                                                 post_nms_topn_, 1);
+  const int num_rois = keep.size();
+  top[0]->Reshape(vector<int>{num_rois, 5});
+  if (top.size() > 1) {
+    top[1]->Reshape(vector<int>{num_rois, 1});
+  }
+  // every box may be dropped by min_size, empty tops are left unallocated
+  if (num_rois == 0) {
+    return;
+  }
+  real_t* rois = top[0]->mutable_cpu_data();
+  for (int i = 0; i < num_rois; ++i) {
+    rois[5 * i] = 0;
+    std::copy(boxes + 4 * keep[i], boxes + 4 * keep[i] + 4, rois + 5 * i + 1);
+  }
+  if (top.size() > 1) {
+    real_t* roi_scores = top[1]->mutable_cpu_data();
+    for (int i = 0; i < num_rois; ++i) {
+      roi_scores[i] = scores[keep[i]];
+    }
+  }
+}
+
+REGISTER_LAYER_CLASS(Proposal);
+
+}  // namespace caffe
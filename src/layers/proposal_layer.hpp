@@ -0,0 +1,71 @@
+#ifndef CAFFE_PROPOSAL_LAYER_HPP_
+#define CAFFE_PROPOSAL_LAYER_HPP_
+
+#include <vector>
+
+#include "../layer.hpp"
+
+namespace caffe {
+
+/**
+ * @brief Generates object proposals from the output of a region proposal
+ *        network, as the proposal layer of Faster R-CNN.
+ *
+ * Anchors of every ratio and scale are placed at each position of the score
+ * map, moved by the predicted box deltas and clipped to the image. Proposals
+ * smaller than min_size are dropped, the pre_nms_topn best go through NMS
+ * and at most post_nms_topn are returned.
+ *
+ * NOTE: does not implement Backwards operation.
+ */
+class ProposalLayer : public Layer {
+ public:
+  explicit ProposalLayer(const LayerParameter& param)
+      : Layer(param) {}
+  virtual void LayerSetUp(const vector<Blob*>& bottom,
+                          const vector<Blob*>& top);
+  virtual void Reshape(const vector<Blob*>& bottom,
+                       const vector<Blob*>& top);
+  virtual void ClearInternalBuffer() {
+    proposals_.Release();
+    scores_.Release();
+  }
+
+  virtual const char* type() const { return "Proposal"; }
+  virtual int ExactNumBottomBlobs() const { return 3; }
+  virtual int MinTopBlobs() const { return 1; }
+  virtual int MaxTopBlobs() const { return 2; }
+
+ protected:
+  /**
+   * @param bottom input Blob vector (length 3)
+   *   -# @f$ (1 \times 2A \times H \times W) @f$
+   *      background then foreground scores of the A anchors
+   *   -# @f$ (1 \times 4A \times H \times W) @f$
+   *      box deltas (dx, dy, dw, dh) of the A anchors
+   *   -# @f$ (1 \times 3) @f$
+   *      image height, width and the scale it was resized by
+   * @param top output Blob vector (length 1 or 2)
+   *   -# @f$ (R \times 5) @f$
+   *      rois as (batch index, x1, y1, x2, y2)
+   *   -# @f$ (R \times 1) @f$
+   *      foreground score of every roi, optional
+   */
+  virtual void Forward_cpu(const vector<Blob*>& bottom,
+                           const vector<Blob*>& top);
+
+  int feat_stride_;
+  int min_size_;
+  int pre_nms_topn_;
+  int post_nms_topn_;
+  real_t nms_thresh_;
+  /// anchors centered on the first score map position, (x1, y1, x2, y2)
+  vector<real_t> anchors_;
+  /// decoded proposals and their scores
+  Blob proposals_;
+  Blob scores_;
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_PROPOSAL_LAYER_HPP_
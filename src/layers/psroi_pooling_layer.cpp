@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "./psroi_pooling_layer.hpp"
+
+namespace caffe {
+
+void PSROIPoolingLayer::LayerSetUp(const vector<Blob*>& /*bottom*/,
+                                   const vector<Blob*>& /*top*/) {
+  const PSROIPoolingParameter& param =
+      this->layer_param_.psroi_pooling_param();
+  spatial_scale_ = param.spatial_scale();
+  output_dim_ = param.output_dim();
+  group_size_ = param.group_size();
+  CHECK_GT(output_dim_, 0) << "output_dim must be > 0";
+  CHECK_GT(group_size_, 0) << "group_size must be > 0";
+}
+
+void PSROIPoolingLayer::Reshape(const vector<Blob*>& bottom,
+                                const vector<Blob*>& top) {
+  CHECK_EQ(bottom[0]->channels(), output_dim_ * group_size_ * group_size_)
+      << "input channel number does not match layer parameters";
+  CHECK_EQ(bottom[1]->count(1), 5) << "rois should be (R, 5).";
+  top[0]->Reshape(bottom[1]->shape(0), output_dim_, group_size_, group_size_);
+}
+
+void PSROIPoolingLayer::Forward_cpu(const vector<Blob*>& bottom,
+                                    const vector<Blob*>& top) {
+  const int num = bottom[0]->num();
+  const int height = bottom[0]->height();
+  const int width = bottom[0]->width();
+  const int num_rois = bottom[1]->shape(0);
+  if (num_rois == 0) {
+    // Proposal kept no roi, the output is empty as well
+    return;
+  }
+  const real_t* rois = bottom[1]->cpu_data();
+  real_t* top_data = top[0]->mutable_cpu_data();
+  // bin edges only depend on the roi, so they are found once for all
+  // output channels
+  vector<int> hstart(group_size_), hend(group_size_);
+  vector<int> wstart(group_size_), wend(group_size_);
+  for (int n = 0; n < num_rois; ++n, rois += 5) {
+    const int batch_index = rois[0];
+    CHECK_GE(batch_index, 0);
+    CHECK_LT(batch_index, num);
+    const real_t roi_start_w = std::round(rois[1]) * spatial_scale_;
+    const real_t roi_start_h = std::round(rois[2]) * spatial_scale_;
+    const real_t roi_end_w = (std::round(rois[3]) + 1) * spatial_scale_;
+    const real_t roi_end_h = (std::round(rois[4]) + 1) * spatial_scale_;
+    // force too small rois to be 1x1
+    const real_t roi_width = std::max<real_t>(roi_end_w - roi_start_w, 0.1);
+    const real_t roi_height = std::max<real_t>(roi_end_h - roi_start_h, 0.1);
+    const real_t bin_size_h = roi_height / group_size_;
+    const real_t bin_size_w = roi_width / group_size_;
+    for (int p = 0; p < group_size_; ++p) {
+      const int h0 = std::floor(p * bin_size_h + roi_start_h);
+      const int h1 = std::ceil((p + 1) * bin_size_h + roi_start_h);
+      hstart[p] = std::min(std::max(h0, 0), height);
+      hend[p] = std::min(std::max(h1, 0), height);
+      const int w0 = std::floor(p * bin_size_w + roi_start_w);
+      const int w1 = std::ceil((p + 1) * bin_size_w + roi_start_w);
+      wstart[p] = std::min(std::max(w0, 0), width);
+      wend[p] = std::min(std::max(w1, 0), width);
+    }
+    const real_t* batch_data = bottom[0]->cpu_data() +
+                               bottom[0]->offset(batch_index);
+    for (int ctop = 0; ctop < output_dim_; ++ctop) {
+      for (int ph = 0; ph < group_size_; ++ph) {
+        for (int pw = 0; pw < group_size_; ++pw) {
+          if (hend[ph] <= hstart[ph] || wend[pw] <= wstart[pw]) {
+            *top_data++ = 0;
+            continue;
+          }
+          const int c = (ctop * group_size_ + ph) * group_size_ + pw;
+          const real_t* data = batch_data + c * height * width;
+          real_t sum = 0;
+          for (int h = hstart[ph]; h < hend[ph]; ++h) {
+            const real_t* row = data + h * width;
+            for (int w = wstart[pw]; w < wend[pw]; ++w) {
+              sum += row[w];
+            }
+          }
+          const int bin_area = (hend[ph] - hstart[ph]) *
+                               (wend[pw] - wstart[pw]);
+          *top_data++ = sum / bin_area;
+        }
+      }
+    }
+  }
+}
+
+REGISTER_LAYER_CLASS(PSROIPooling);
+
+}  // namespace caffe
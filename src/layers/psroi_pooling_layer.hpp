@@ -0,0 +1,53 @@
+#ifndef CAFFE_PSROI_POOLING_LAYER_HPP_
+#define CAFFE_PSROI_POOLING_LAYER_HPP_
+
+#include <vector>
+
+#include "../layer.hpp"
+
+namespace caffe {
+
+/**
+ * @brief Position sensitive RoI pooling of R-FCN.
+ *
+ * Every region of interest is split into a group_size x group_size grid and
+ * each bin averages its own score map, so the bottom holds
+ * output_dim * group_size * group_size channels.
+ *
+ * NOTE: does not implement Backwards operation.
+ */
+class PSROIPoolingLayer : public Layer {
+ public:
+  explicit PSROIPoolingLayer(const LayerParameter& param)
+      : Layer(param) {}
+  virtual void LayerSetUp(const vector<Blob*>& bottom,
+                          const vector<Blob*>& top);
+  virtual void Reshape(const vector<Blob*>& bottom,
+                       const vector<Blob*>& top);
+
+  virtual const char* type() const { return "PSROIPooling"; }
+  virtual int ExactNumBottomBlobs() const { return 2; }
+  virtual int ExactNumTopBlobs() const { return 1; }
+
+ protected:
+  /**
+   * @param bottom input Blob vector (length 2)
+   *   -# @f$ (N \times output\_dim \cdot group\_size^2 \times H \times W) @f$
+   *      the position sensitive score maps
+   *   -# @f$ (R \times 5) @f$
+   *      rois as (batch index, x1, y1, x2, y2) in input image pixels
+   * @param top output Blob vector (length 1)
+   *   -# @f$ (R \times output\_dim \times group\_size \times group\_size) @f$
+   *      the pooled rois, empty bins are 0
+   */
+  virtual void Forward_cpu(const vector<Blob*>& bottom,
+                           const vector<Blob*>& top);
+
+  real_t spatial_scale_;
+  int output_dim_;
+  int group_size_;
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_PSROI_POOLING_LAYER_HPP_
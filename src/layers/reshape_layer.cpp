@@ -1,6 +1,7 @@
 #include <vector>
 
 #include "./reshape_layer.hpp"
+#include "../util/math_functions.hpp"
 
 namespace caffe {
 
@@ -84,7 +85,18 @@ void ReshapeLayer::Reshape(const vector<Blob*>& bottom,
   top[0]->Reshape(top_shape);
   CHECK_EQ(top[0]->count(), bottom[0]->count())
       << "output count must match input count";
-  top[0]->ShareData(*bottom[0]);
+  // memory bound by the caller is written by Forward instead
+  if (!top[0]->external_data()) {
+    top[0]->ShareData(*bottom[0]);
+  }
+}
+
+void ReshapeLayer::Forward_cpu(const vector<Blob*>& bottom,
+                               const vector<Blob*>& top) {
+  if (top[0]->external_data()) {
+    caffe_copy(top[0]->count(), bottom[0]->cpu_data(),
+               top[0]->mutable_cpu_data());
+  }
 }
 
 REGISTER_LAYER_CLASS(Reshape);
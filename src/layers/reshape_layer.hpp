@@ -28,7 +28,7 @@ class ReshapeLayer : public Layer {
 
  protected:
   virtual void Forward_cpu(const vector<Blob*>& bottom,
-                           const vector<Blob*>& top) {}
+                           const vector<Blob*>& top);
 
   /// @brief vector of axes indices whose dimensions we'll copy from the bottom
   vector<int> copy_axes_;
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+#include "./roi_pooling_layer.hpp"
+
+namespace caffe {
+
+void ROIPoolingLayer::LayerSetUp(const vector<Blob*>& /*bottom*/,
+                                 const vector<Blob*>& /*top*/) {
+  const ROIPoolingParameter& param = this->layer_param_.roi_pooling_param();
+  CHECK_GT(param.pooled_h(), 0) << "pooled_h must be > 0";
+  CHECK_GT(param.pooled_w(), 0) << "pooled_w must be > 0";
+  pooled_height_ = param.pooled_h();
+  pooled_width_ = param.pooled_w();
+  spatial_scale_ = param.spatial_scale();
+}
+
+void ROIPoolingLayer::Reshape(const vector<Blob*>& bottom,
+                              const vector<Blob*>& top) {
+  CHECK_EQ(bottom[1]->count(1), 5) << "rois should be (R, 5).";
+  top[0]->Reshape(bottom[1]->shape(0), bottom[0]->channels(),
+                  pooled_height_, pooled_width_);
+}
+
+void ROIPoolingLayer::Forward_cpu(const vector<Blob*>& bottom,
+                                  const vector<Blob*>& top) {
+  const int num = bottom[0]->num();
+  const int channels = bottom[0]->channels();
+  const int height = bottom[0]->height();
+  const int width = bottom[0]->width();
+  const int num_rois = bottom[1]->shape(0);
+  if (num_rois == 0) {
+    // Proposal kept no roi, the output is empty as well
+    return;
+  }
+  const real_t* rois = bottom[1]->cpu_data();
+  real_t* top_data = top[0]->mutable_cpu_data();
+  // bin edges only depend on the roi, so they are found once for all
+  // channels
+  vector<int> hstart(pooled_height_), hend(pooled_height_);
+  vector<int> wstart(pooled_width_), wend(pooled_width_);
+  for (int n = 0; n < num_rois; ++n, rois += 5) {
+    const int batch_index = rois[0];
+    CHECK_GE(batch_index, 0);
+    CHECK_LT(batch_index, num);
+    const int roi_start_w = std::round(rois[1] * spatial_scale_);
+    const int roi_start_h = std::round(rois[2] * spatial_scale_);
+    const int roi_end_w = std::round(rois[3] * spatial_scale_);
+    const int roi_end_h = std::round(rois[4] * spatial_scale_);
+    const int roi_height = std::max(roi_end_h - roi_start_h + 1, 1);
+    const int roi_width = std::max(roi_end_w - roi_start_w + 1, 1);
+    const real_t bin_size_h = static_cast<real_t>(roi_height) / pooled_height_;
+    const real_t bin_size_w = static_cast<real_t>(roi_width) / pooled_width_;
+    for (int ph = 0; ph < pooled_height_; ++ph) {
+      const int start = std::floor(ph * bin_size_h) + roi_start_h;
+      const int end = std::ceil((ph + 1) * bin_size_h) + roi_start_h;
+      hstart[ph] = std::min(std::max(start, 0), height);
+      hend[ph] = std::min(std::max(end, 0), height);
+    }
+    for (int pw = 0; pw < pooled_width_; ++pw) {
+      const int start = std::floor(pw * bin_size_w) + roi_start_w;
+      const int end = std::ceil((pw + 1) * bin_size_w) + roi_start_w;
+      wstart[pw] = std::min(std::max(start, 0), width);
+      wend[pw] = std::min(std::max(end, 0), width);
+    }
+    const real_t* batch_data = bottom[0]->cpu_data() +
+                               bottom[0]->offset(batch_index);
+    for (int c = 0; c < channels; ++c) {
+      const real_t* data = batch_data + c * height * width;
+      for (int ph = 0; ph < pooled_height_; ++ph) {
+        for (int pw = 0; pw < pooled_width_; ++pw) {
+          if (hend[ph] <= hstart[ph] || wend[pw] <= wstart[pw]) {
+            *top_data++ = 0;
+            continue;
+          }
+          real_t max_val = -FLT_MAX;
+          for (int h = hstart[ph]; h < hend[ph]; ++h) {
+            const real_t* row = data + h * width;
+            for (int w = wstart[pw]; w < wend[pw]; ++w) {
+              max_val = row[w] > max_val ? row[w] : max_val;
+            }
+          }
+          *top_data++ = max_val;
+        }
+      }
+    }
+  }
+}
+
+REGISTER_LAYER_CLASS(ROIPooling);
+
+}  // namespace caffe
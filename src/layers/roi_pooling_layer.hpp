@@ -0,0 +1,50 @@
+#ifndef CAFFE_ROI_POOLING_LAYER_HPP_
+#define CAFFE_ROI_POOLING_LAYER_HPP_
+
+#include <vector>
+
+#include "../layer.hpp"
+
+namespace caffe {
+
+/**
+ * @brief Max pools every region of interest into a fixed pooled_h x pooled_w
+ *        grid, as the RoI pooling of Fast R-CNN.
+ *
+ * NOTE: does not implement Backwards operation.
+ */
+class ROIPoolingLayer : public Layer {
+ public:
+  explicit ROIPoolingLayer(const LayerParameter& param)
+      : Layer(param) {}
+  virtual void LayerSetUp(const vector<Blob*>& bottom,
+                          const vector<Blob*>& top);
+  virtual void Reshape(const vector<Blob*>& bottom,
+                       const vector<Blob*>& top);
+
+  virtual const char* type() const { return "ROIPooling"; }
+  virtual int ExactNumBottomBlobs() const { return 2; }
+  virtual int ExactNumTopBlobs() const { return 1; }
+
+ protected:
+  /**
+   * @param bottom input Blob vector (length 2)
+   *   -# @f$ (N \times C \times H \times W) @f$
+   *      the feature maps
+   *   -# @f$ (R \times 5) @f$
+   *      rois as (batch index, x1, y1, x2, y2) in input image pixels
+   * @param top output Blob vector (length 1)
+   *   -# @f$ (R \times C \times pooled_h \times pooled_w) @f$
+   *      the pooled rois, empty bins are 0
+   */
+  virtual void Forward_cpu(const vector<Blob*>& bottom,
+                           const vector<Blob*>& top);
+
+  int pooled_height_;
+  int pooled_width_;
+  real_t spatial_scale_;
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_ROI_POOLING_LAYER_HPP_
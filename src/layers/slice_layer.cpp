@@ -36,6 +36,19 @@ void SliceLayer::Reshape(const vector<Blob*>& bottom,
   const int bottom_slice_axis = bottom[0]->shape(slice_axis_);
   num_slices_ = bottom[0]->count(0, slice_axis_);
   slice_size_ = bottom[0]->count(slice_axis_ + 1);
+  // every top is a contiguous part of bottom if the outer count is 1, view
+  // it without copy unless the caller bound memory to a top
+  bool views = top_views_ && top.size() > 1 && num_slices_ == 1;
+  for (size_t i = 0; i < top.size(); ++i) {
+    views = views && !top[i]->external_data();
+  }
+  if (views_ && !views) {
+    // tops still see the bottom, give them memory of their own
+    for (size_t i = 0; i < top.size(); ++i) {
+      if (!top[i]->external_data()) top[i]->Release();
+    }
+  }
+  views_ = views;
   int count = 0;
   if (slice_point_.size() != 0) {
     CHECK_EQ(slice_point_.size(), top.size() - 1);
@@ -65,13 +78,21 @@ void SliceLayer::Reshape(const vector<Blob*>& bottom,
   }
   CHECK_EQ(count, bottom[0]->count());
   if (top.size() == 1) {
-    top[0]->ShareData(*bottom[0]);
+    // memory bound by the caller is written by Forward instead
+    if (!top[0]->external_data()) top[0]->ShareData(*bottom[0]);
+  }
+  else if (views_) {
+    int offset = 0;
+    for (size_t i = 0; i < top.size(); ++i) {
+      top[i]->ShareData(*bottom[0], offset);
+      offset += top[i]->count();
+    }
   }
 }
 
 void SliceLayer::Forward_cpu(const vector<Blob*>& bottom,
                              const vector<Blob*>& top) {
-  if (top.size() == 1) { return; }
+  if ((top.size() == 1 && !top[0]->external_data()) || views_) { return; }
   int offset_slice_axis = 0;
   const real_t* bottom_data = bottom[0]->cpu_data();
   const int bottom_slice_axis = bottom[0]->shape(slice_axis_);
@@ -25,7 +25,7 @@ __global__ void Slice(const int nthreads, const real_t* in_data,
 
 void SliceLayer::Forward_gpu(const vector<Blob*>& bottom,
                              const vector<Blob*>& top) {
-  if (top.size() == 1) { return; }
+  if ((top.size() == 1 && !top[0]->external_data()) || views_) { return; }
   int offset_slice_axis = 0;
   const real_t* bottom_data = bottom[0]->gpu_data();
   const int bottom_slice_axis = bottom[0]->shape(slice_axis_);
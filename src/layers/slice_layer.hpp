@@ -16,12 +16,14 @@ namespace caffe {
 class SliceLayer : public Layer {
  public:
   explicit SliceLayer(const LayerParameter& param)
-      : Layer(param) {}
+      : Layer(param), top_views_(false), views_(false) {}
   virtual void LayerSetUp(const vector<Blob*>& bottom,
                           const vector<Blob*>& top);
   virtual void Reshape(const vector<Blob*>& bottom,
                        const vector<Blob*>& top);
 
+  virtual void AllowTopViews(bool allow) { top_views_ = allow; }
+
   virtual const char* type() const { return "Slice"; }
   virtual int ExactNumBottomBlobs() const { return 1; }
   virtual int MinTopBlobs() const { return 1; }
@@ -37,6 +39,10 @@ class SliceLayer : public Layer {
   int slice_size_;
   int slice_axis_;
   vector<int> slice_point_;
+  /// @brief whether Net allows tops to be views of the bottom
+  bool top_views_;
+  /// @brief whether the tops are views of the bottom, set by Reshape
+  bool views_;
 };
 
 }  // namespace caffe
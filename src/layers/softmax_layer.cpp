@@ -1,4 +1,6 @@
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 
 #include "./softmax_layer.hpp"
@@ -15,10 +17,6 @@ void SoftmaxLayer::Reshape(const vector<Blob*>& bottom,
   softmax_axis_ =
       bottom[0]->CanonicalAxisIndex(this->layer_param_.softmax_param().axis());
   top[0]->ReshapeLike(*bottom[0]);
-  vector<int> mult_dims(1, bottom[0]->shape(softmax_axis_));
-  sum_multiplier_.Reshape(mult_dims);
-  real_t* multiplier_data = sum_multiplier_.mutable_cpu_data();
-  caffe_set(sum_multiplier_.count(), static_cast<real_t>(1), multiplier_data);
   outer_num_ = bottom[0]->count(0, softmax_axis_);
   inner_num_ = bottom[0]->count(softmax_axis_ + 1);
   vector<int> scale_dims = bottom[0]->shape();
@@ -26,38 +24,105 @@ void SoftmaxLayer::Reshape(const vector<Blob*>& bottom,
   scale_.Reshape(scale_dims);
 }
 
+/*!
+ * \brief exp of x in [-87.3, 0], the range of shifted softmax inputs.
+ *  Cephes polynomial on x - n * ln2 scaled by 2^n built in the exponent
+ *  bits, it has no branch or call so loops over it are vectorized.
+ */
+static inline float ShiftedExp(float x) {
+  const float kRound = 12582912.f;  // 1.5 * 2^23, rounds to nearest integer
+  const float n = (x * 1.44269504088896341f + kRound) - kRound;
+  x -= n * 0.693359375f;
+  x -= n * -2.12194440e-4f;
+  float y = 1.9875691500e-4f;
+  y = y * x + 1.3981999507e-3f;
+  y = y * x + 8.3334519073e-3f;
+  y = y * x + 4.1665795894e-2f;
+  y = y * x + 1.6666665459e-1f;
+  y = y * x + 5.0000001201e-1f;
+  y = y * x * x + x + 1.f;
+  const int32_t bits = (static_cast<int32_t>(n) + 127) << 23;
+  float scale;
+  std::memcpy(&scale, &bits, sizeof(scale));
+  return y * scale;
+}
+
 void SoftmaxLayer::Forward_cpu(const vector<Blob*>& bottom,
                                const vector<Blob*>& top) {
   const real_t* bottom_data = bottom[0]->cpu_data();
   real_t* top_data = top[0]->mutable_cpu_data();
-  real_t* scale_data = scale_.mutable_cpu_data();
-  int channels = bottom[0]->shape(softmax_axis_);
-  int dim = bottom[0]->count() / outer_num_;
-  caffe_copy(bottom[0]->count(), bottom_data, top_data);
+  const int channels = bottom[0]->shape(softmax_axis_);
+  const int dim = channels * inner_num_;
   // We need to subtract the max to avoid numerical issues, compute the exp,
-  // and then normalize.
-  for (int i = 0; i < outer_num_; ++i) {
-    // initialize scale_data to the first plane
-    caffe_copy(inner_num_, bottom_data + i * dim, scale_data);
-    for (int j = 0; j < channels; j++) {
-      for (int k = 0; k < inner_num_; k++) {
-        scale_data[k] = std::max(scale_data[k],
-            bottom_data[i * dim + j * inner_num_ + k]);
+  // and then normalize. Shifted inputs are clamped at the underflow of exp,
+  // which only drops values below 1e-38 of the max. All passes run over
+  // data in cache and bottom and top may be the same memory.
+  const real_t kMinShifted = -87.3f;
+  if (inner_num_ == 1) {
+    // classification, every row of channels is contiguous
+    for (int i = 0; i < outer_num_; ++i) {
+      const real_t* x = bottom_data + i * dim;
+      real_t* y = top_data + i * dim;
+      real_t max_val = x[0];
+      for (int j = 1; j < channels; ++j) {
+        max_val = std::max(max_val, x[j]);
+      }
+      for (int j = 0; j < channels; ++j) {
+        y[j] = std::max(x[j] - max_val, kMinShifted);
+      }
+      for (int j = 0; j < channels; ++j) {
+        y[j] = ShiftedExp(y[j]);
+      }
+      real_t sum = 0;
+      for (int j = 0; j < channels; ++j) {
+        sum += y[j];
+      }
+      const real_t inv = 1 / sum;
+      for (int j = 0; j < channels; ++j) {
+        y[j] *= inv;
       }
     }
-    // subtraction
-    caffe_cpu_gemm(CblasNoTrans, CblasNoTrans, channels, inner_num_,
-      1, static_cast<real_t>(-1), sum_multiplier_.cpu_data(), scale_data,
-      static_cast<real_t>(1), top_data);
-    // exponentiation
-    caffe_exp(dim, top_data, top_data);
-    // sum after exp
-    caffe_cpu_gemv(CblasTrans, channels, inner_num_, static_cast<real_t>(1),
-      top_data, sum_multiplier_.cpu_data(), static_cast<real_t>(0), scale_data);
-    // division
-    for (int j = 0; j < channels; j++) {
-      caffe_div(inner_num_, top_data, scale_data, top_data);
-      top_data += inner_num_;
+    return;
+  }
+  // per pixel scores, walk the spatial axis in tiles so all channels of a
+  // tile stay in cache and loops over the tile are contiguous
+  const int kTile = 256;
+  real_t max_val[kTile];
+  real_t sum[kTile];
+  for (int i = 0; i < outer_num_; ++i) {
+    for (int k0 = 0; k0 < inner_num_; k0 += kTile) {
+      const int len = std::min(kTile, inner_num_ - k0);
+      const real_t* x = bottom_data + i * dim + k0;
+      real_t* y = top_data + i * dim + k0;
+      std::copy(x, x + len, max_val);
+      for (int j = 1; j < channels; ++j) {
+        const real_t* xj = x + j * inner_num_;
+        for (int k = 0; k < len; ++k) {
+          const real_t v = xj[k];
+          max_val[k] = v > max_val[k] ? v : max_val[k];
+        }
+      }
+      std::fill(sum, sum + len, static_cast<real_t>(0));
+      for (int j = 0; j < channels; ++j) {
+        const real_t* xj = x + j * inner_num_;
+        real_t* yj = y + j * inner_num_;
+        for (int k = 0; k < len; ++k) {
+          yj[k] = std::max(xj[k] - max_val[k], kMinShifted);
+        }
+        for (int k = 0; k < len; ++k) {
+          yj[k] = ShiftedExp(yj[k]);
+          sum[k] += yj[k];
+        }
+      }
+      for (int k = 0; k < len; ++k) {
+        sum[k] = 1 / sum[k];
+      }
+      for (int j = 0; j < channels; ++j) {
+        real_t* yj = y + j * inner_num_;
+        for (int k = 0; k < len; ++k) {
+          yj[k] *= sum[k];
+        }
+      }
     }
   }
 }
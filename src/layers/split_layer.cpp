@@ -24,7 +24,12 @@ void SplitLayer::Reshape(const vector<Blob*>& bottom,
 void SplitLayer::Forward_cpu(const vector<Blob*>& bottom,
                              const vector<Blob*>& top) {
   for (int i = 0; i < top.size(); ++i) {
-    top[i]->ShareData(*bottom[0]);
+    // memory bound by the caller must be written, not replaced
+    if (top[i]->external_data()) {
+      caffe_copy(count_, bottom[0]->cpu_data(), top[i]->mutable_cpu_data());
+    } else {
+      top[i]->ShareData(*bottom[0]);
+    }
   }
 }
 
@@ -8,7 +8,11 @@ namespace caffe {
 void SplitLayer::Forward_gpu(const vector<Blob*>& bottom,
                              const vector<Blob*>& top) {
   for (int i = 0; i < top.size(); ++i) {
-    top[i]->ShareData(*bottom[0]);
+    if (top[i]->external_data()) {
+      caffe_copy(count_, bottom[0]->gpu_data(), top[i]->mutable_gpu_data());
+    } else {
+      top[i]->ShareData(*bottom[0]);
+    }
   }
 }
 
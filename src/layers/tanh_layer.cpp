@@ -1,6 +1,7 @@
 // TanH neuron activation function layer.
 // Adapted from ReLU layer code written by Yangqing Jia
 
+#include <cmath>
 #include <vector>
 
 #include "./tanh_layer.hpp"
@@ -1,5 +1,7 @@
 #include <algorithm>
+#include <functional>
 #include <map>
+#include <numeric>
 #include <set>
 #include <string>
 #include <utility>
@@ -11,6 +13,7 @@
 #include "caffe/net.hpp"
 #include "caffe/profiler.hpp"
 #include "./layer.hpp"
+#include "./syncedmem.hpp"
 #include "./util/math_functions.hpp"
 #include "./util/upgrade_proto.hpp"
 #include "./util/insert_splits.hpp"
@@ -47,6 +50,8 @@ void Net::Init(const NetParameter& in_param) {
   bottom_id_vecs_.resize(param.layer_size());
   top_id_vecs_.resize(param.layer_size());
   param_id_vecs_.resize(param.layer_size());
+  // layer parameters are allocated during creation and set up
+  MemArenaScope weight_arena(kWeightArena);
   for (int layer_id = 0; layer_id < param.layer_size(); ++layer_id) {
     // Setup layer.
     const LayerParameter& layer_param = param.layer(layer_id);
@@ -86,8 +91,28 @@ void Net::Init(const NetParameter& in_param) {
     net_output_blob_indices_.push_back(blob_name_to_idx[*it]);
   }
   // for most case, not fully convolutional network, hold input data will be convenient
+  blob_pinned_.assign(blobs_.size(), false);
   for (int blob_id : top_id_vecs_[0]) {
     blob_life_time_[blob_id] = layers_.size();
+    blob_pinned_[blob_id] = true;
+  }
+  layer_active_.assign(layers_.size(), true);
+  layer_params_released_.assign(layers_.size(), false);
+  PlanConcatViews();
+  PlanInPlace();
+  PlanTopViews();
+  // let layers absorb a following layer working in place on their output,
+  // e.g. BatchNorm with its Scale
+  layer_fused_.assign(layers_.size(), false);
+  const int num_layers = layers_.size();
+  for (int layer_id = 0; layer_id + 1 < num_layers; ++layer_id) {
+    const vector<int>& tops = top_id_vecs_[layer_id];
+    const vector<int>& next_bottoms = bottom_id_vecs_[layer_id + 1];
+    const vector<int>& next_tops = top_id_vecs_[layer_id + 1];
+    if (tops.size() == 1 && next_bottoms == tops && next_tops == tops &&
+        layers_[layer_id]->FuseNext(layers_[layer_id + 1].get())) {
+      layer_fused_[layer_id + 1] = true;
+    }
   }
   for (size_t blob_id = 0; blob_id < blob_names_.size(); ++blob_id) {
     blob_names_index_[blob_names_[blob_id]] = blob_id;
@@ -282,11 +307,26 @@ void Net::ForwardFromTo(int start, int end) {
   CHECK_GE(start, 0);
   CHECK_LT(end, layers_.size());
   Profiler *profiler = Profiler::Get();
+  const bool cpu = Caffe::mode() == Caffe::CPU;
   for (int i = start; i <= end; ++i) {
+    if (!layer_active_[i] || (cpu && layer_fused_[i])) continue;
     // LOG(ERROR) << "Forwarding " << layer_names_[i];
+    for (auto& view : layer_concat_views_[i]) {
+      SetupConcatView(view.first, view.second);
+    }
+    if (layer_auto_inplace_[i]) {
+      SetupInPlace(i);
+    }
+    const int plan_id = layer_concat_plan_[i];
+    if (plan_id >= 0) {
+      CheckConcatViews(plan_id);
+    }
     profiler->ScopeStart(layer_names_[i].c_str());
     layers_[i]->Forward(bottom_vecs_[i], top_vecs_[i]);
     profiler->ScopeEnd();
+    if (plan_id >= 0) {
+      RecordConcatShapes(plan_id);
+    }
     // try to free bottom blobs
     for (int blob_idx : bottom_id_vecs_[i]) {
       if (blob_life_time_[blob_idx] <= i) {
@@ -296,6 +336,213 @@ void Net::ForwardFromTo(int start, int end) {
   }
 }
 
+/// @brief whether a layer type may give its tops memory of other blobs
+static bool SharesData(const string& type) {
+  return type == "Input" || type == "Split" || type == "Flatten" ||
+         type == "Reshape" || type == "Slice" || type == "Concat" ||
+         type == "Parameter";
+}
+
+/// @brief whether a layer type computes every output element from the
+///        same element of its input, so it can safely run in place
+static bool IsElementwise(const string& type) {
+  return type == "ReLU" || type == "PReLU" || type == "Sigmoid" ||
+         type == "TanH" || type == "AbsVal" || type == "BNLL" ||
+         type == "ELU" || type == "Exp" || type == "Log" ||
+         type == "Power" || type == "Threshold" || type == "Dropout" ||
+         type == "BatchNorm" || type == "Scale" || type == "Bias";
+}
+
+vector<int> Net::FindProducers() const {
+  // first layer writing every blob, later in-place layers keep its memory
+  vector<int> producer(blobs_.size(), -1);
+  for (size_t i = 0; i < layers_.size(); ++i) {
+    for (int blob_id : top_id_vecs_[i]) {
+      if (producer[blob_id] < 0) producer[blob_id] = i;
+    }
+  }
+  return producer;
+}
+
+void Net::PlanInPlace() {
+  const int num_layers = layers_.size();
+  const vector<int> producer = FindProducers();
+  layer_auto_inplace_.assign(num_layers, false);
+  for (int i = 0; i < num_layers; ++i) {
+    if (!IsElementwise(layers_[i]->type()) ||
+        bottom_id_vecs_[i].size() != 1 || top_id_vecs_[i].size() != 1 ||
+        bottom_id_vecs_[i][0] == top_id_vecs_[i][0] ||
+        !layer_concat_views_[i].empty()) {
+      continue;
+    }
+    // memory of the bottom must not be seen through any other blob, which
+    // is the case for tops of Split and other data sharing layers
+    const int p = producer[bottom_id_vecs_[i][0]];
+    layer_auto_inplace_[i] = !SharesData(layers_[p]->type());
+  }
+}
+
+void Net::SetupInPlace(int i) {
+  const int bottom_id = bottom_id_vecs_[i][0];
+  const int top_id = top_id_vecs_[i][0];
+  // checked on every forward as marking, binding and SetOutputs change
+  // which blobs are still read after this layer, memory bound by the caller
+  // through the Blob alone is not pinned but must keep being written
+  if (blob_pinned_[bottom_id] || blob_pinned_[top_id] ||
+      blob_life_time_[bottom_id] != i || blobs_[bottom_id]->count() == 0 ||
+      blobs_[bottom_id]->external_data() || blobs_[top_id]->external_data()) {
+    return;
+  }
+  Blob* top = blobs_[top_id].get();
+  top->ReshapeLike(*blobs_[bottom_id]);
+  top->ShareData(*blobs_[bottom_id]);
+}
+
+void Net::PlanConcatViews() {
+  const int num_layers = layers_.size();
+  layer_concat_views_.assign(num_layers, vector<std::pair<int, int> >());
+  layer_concat_plan_.assign(num_layers, -1);
+  const vector<int> producer = FindProducers();
+  for (int i = 0; i < num_layers; ++i) {
+    if (string(layers_[i]->type()) != "Concat" ||
+        bottom_id_vecs_[i].size() < 2) {
+      continue;
+    }
+    const vector<int>& bottom_ids = bottom_id_vecs_[i];
+    if (std::find(bottom_ids.begin(), bottom_ids.end(), top_id_vecs_[i][0]) !=
+        bottom_ids.end()) {
+      continue;
+    }
+    ConcatPlan plan;
+    plan.layer_id = i;
+    bool any_view = false;
+    for (int blob_id : bottom_id_vecs_[i]) {
+      // the bottom must be written by its producer into memory of its own,
+      // nested Concat can not write into a view either
+      const int p = producer[blob_id];
+      const bool view = !SharesData(layers_[p]->type()) &&
+          !blob_pinned_[blob_id] && blob_life_time_[blob_id] == i;
+      plan.view.push_back(view);
+      any_view = any_view || view;
+    }
+    if (!any_view) continue;
+    const int plan_id = concat_plans_.size();
+    for (size_t k = 0; k < plan.view.size(); ++k) {
+      if (plan.view[k]) {
+        const int p = producer[bottom_id_vecs_[i][k]];
+        layer_concat_views_[p].push_back(std::make_pair(plan_id, k));
+      }
+    }
+    layer_concat_plan_[i] = plan_id;
+    concat_plans_.push_back(plan);
+  }
+}
+
+void Net::PlanTopViews() {
+  const int num_layers = layers_.size();
+  const vector<int> producer = FindProducers();
+  for (int i = 0; i < num_layers; ++i) {
+    // the bottoms hold memory of their own which only this layer reads
+    bool allow = true;
+    for (int blob_id : bottom_id_vecs_[i]) {
+      allow = allow && !SharesData(layers_[producer[blob_id]]->type());
+      for (int j = 0; allow && j < num_layers; ++j) {
+        const vector<int>& bottom_ids = bottom_id_vecs_[j];
+        allow = j == i || std::find(bottom_ids.begin(), bottom_ids.end(),
+                                    blob_id) == bottom_ids.end();
+      }
+    }
+    // no reader of the tops, or of blobs sharing their memory behind Split
+    // and alike, writes in place
+    vector<bool> seen(blobs_.size(), false);
+    for (int blob_id : top_id_vecs_[i]) {
+      seen[blob_id] = true;
+    }
+    for (int j = i + 1; allow && j < num_layers; ++j) {
+      bool reads = false;
+      for (int blob_id : bottom_id_vecs_[j]) {
+        reads = reads || seen[blob_id];
+      }
+      if (!reads) continue;
+      allow = !layer_auto_inplace_[j];
+      for (int blob_id : top_id_vecs_[j]) {
+        allow = allow && !seen[blob_id];
+      }
+      if (SharesData(layers_[j]->type())) {
+        for (int blob_id : top_id_vecs_[j]) {
+          seen[blob_id] = true;
+        }
+      }
+    }
+    layers_[i]->AllowTopViews(allow);
+  }
+}
+
+void Net::SetupConcatView(int plan_id, int k) {
+  const ConcatPlan& plan = concat_plans_[plan_id];
+  const int i = plan.layer_id;
+  const int blob_id = bottom_id_vecs_[i][k];
+  // blobs bound, marked or requested by SetOutputs after planning keep
+  // memory of their own
+  Blob* top = top_vecs_[i][0];
+  if (plan.top_shape.empty() || blob_pinned_[blob_id] ||
+      blob_life_time_[blob_id] != i ||
+      !layer_active_[i] || blobs_[blob_id]->external_data() ||
+      top->external_data()) {
+    return;
+  }
+  if (top->shape() != plan.top_shape) {
+    top->Reshape(plan.top_shape);
+  }
+  int offset = 0;
+  for (int j = 0; j < k; ++j) {
+    offset += std::accumulate(plan.bottom_shapes[j].begin(),
+                              plan.bottom_shapes[j].end(),
+                              1, std::multiplies<int>());
+  }
+  Blob* blob = blobs_[blob_id].get();
+  blob->Reshape(plan.bottom_shapes[k]);
+  blob->ShareData(*top, offset);
+}
+
+bool Net::CheckConcatViews(int plan_id) {
+  const ConcatPlan& plan = concat_plans_[plan_id];
+  const vector<Blob*>& bottom = bottom_vecs_[plan.layer_id];
+  bool hold = !plan.top_shape.empty();
+  for (size_t k = 0; hold && k < bottom.size(); ++k) {
+    hold = bottom[k]->shape() == plan.bottom_shapes[k];
+  }
+  if (hold) return true;
+  // the output will be laid out differently, views may overlap other parts
+  for (size_t k = 0; k < bottom.size(); ++k) {
+    if (!plan.view[k] || bottom[k]->count() == 0) continue;
+    Blob copy(bottom[k]->shape());
+    caffe_copy(copy.count(), bottom[k]->cpu_data(), copy.mutable_cpu_data());
+    bottom[k]->Release();
+    bottom[k]->ReshapeLike(copy);
+    bottom[k]->ShareData(copy);
+  }
+  return false;
+}
+
+void Net::RecordConcatShapes(int plan_id) {
+  ConcatPlan& plan = concat_plans_[plan_id];
+  const vector<Blob*>& bottom = bottom_vecs_[plan.layer_id];
+  const Blob* top = top_vecs_[plan.layer_id][0];
+  const ConcatParameter& concat_param =
+      layers_[plan.layer_id]->layer_param().concat_param();
+  const int axis = concat_param.has_concat_dim() ?
+      static_cast<int>(concat_param.concat_dim()) :
+      top->CanonicalAxisIndex(concat_param.axis());
+  plan.top_shape.clear();
+  plan.bottom_shapes.clear();
+  if (top->count(0, axis) != 1) return;
+  plan.top_shape = top->shape();
+  for (size_t k = 0; k < bottom.size(); ++k) {
+    plan.bottom_shapes.push_back(bottom[k]->shape());
+  }
+}
+
 void Net::ForwardFrom(int start) {
   return ForwardFromTo(start, layers_.size() - 1);
 }
@@ -306,11 +553,13 @@ void Net::ForwardTo(int end) {
 
 void Net::Reshape() {
   for (int i = 0; i < layers_.size(); ++i) {
+    if (!layer_active_[i]) continue;
     layers_[i]->Reshape(bottom_vecs_[i], top_vecs_[i]);
   }
 }
 
 void Net::CopyTrainedLayersFrom(const NetParameter& param) {
+  MemArenaScope weight_arena(kWeightArena);
   int num_source_layers = param.layer_size();
   for (int i = 0; i < num_source_layers; ++i) {
     const LayerParameter& source_layer = param.layer(i);
@@ -320,7 +569,8 @@ void Net::CopyTrainedLayersFrom(const NetParameter& param) {
            layer_names_[target_layer_id] != source_layer_name) {
       ++target_layer_id;
     }
-    if (target_layer_id == layer_names_.size()) {
+    if (target_layer_id == layer_names_.size() ||
+        layer_params_released_[target_layer_id]) {
       continue;
     }
     vector<shared_ptr<Blob> >& target_blobs =
@@ -353,7 +603,137 @@ void Net::MarkOutputs(const std::vector<std::string>& outs) {
     }
     int blob_id = it->second;
     blob_life_time_[blob_id] = layers_.size();
+    blob_pinned_[blob_id] = true;
+  }
+}
+
+void Net::SetOutputs(const std::vector<std::string>& outs,
+                     bool release_params) {
+  vector<int> requested;
+  for (auto& name : outs) {
+    auto it = blob_names_index_.find(name);
+    if (it == blob_names_index_.end()) {
+      LOG(FATAL) << "blob (" << name << ") is not availiable in Net";
+    }
+    requested.push_back(it->second);
+  }
+  // walk backward from the requested blobs, a layer is needed if any of its
+  // tops is needed, then all of its bottoms are needed
+  const int num_layers = layers_.size();
+  vector<bool> needed(blobs_.size(), requested.empty());
+  vector<bool> layer_active(num_layers, false);
+  for (int blob_id : requested) {
+    needed[blob_id] = true;
+  }
+  for (int i = num_layers - 1; i >= 0; --i) {
+    bool active = requested.empty() || i == 0;
+    for (int blob_id : top_id_vecs_[i]) {
+      active = active || needed[blob_id];
+    }
+    if (active) {
+      CHECK(!layer_params_released_[i]) << "weights of layer "
+          << layer_names_[i] << " are released, it can not be used again";
+      for (int blob_id : bottom_id_vecs_[i]) {
+        needed[blob_id] = true;
+      }
+    }
+    layer_active[i] = active;
+  }
+  requested_outputs_.swap(requested);
+  layer_active_.swap(layer_active);
+  // free blobs nobody produces any more
+  vector<bool> produced(blobs_.size(), false);
+  for (int i = 0; i < num_layers; ++i) {
+    if (!layer_active_[i]) continue;
+    for (int blob_id : top_id_vecs_[i]) {
+      produced[blob_id] = true;
+    }
+  }
+  for (size_t blob_id = 0; blob_id < blobs_.size(); ++blob_id) {
+    if (!produced[blob_id] && !blob_pinned_[blob_id]) {
+      blobs_[blob_id]->Release();
+    }
+  }
+  if (release_params) {
+    for (int i = 0; i < num_layers; ++i) {
+      if (layer_active_[i]) continue;
+      for (auto& param : layers_[i]->blobs()) {
+        param->Release();
+      }
+      layer_params_released_[i] = true;
+    }
+  }
+  UpdateBlobLifeTime();
+}
+
+void Net::UpdateBlobLifeTime() {
+  // same rules as AppendTop and AppendBottom, only over active layers
+  const int num_layers = layers_.size();
+  blob_life_time_.assign(blobs_.size(), 0);
+  for (int i = 0; i < num_layers; ++i) {
+    if (!layer_active_[i]) continue;
+    for (int blob_id : bottom_id_vecs_[i]) {
+      blob_life_time_[blob_id] = std::max(blob_life_time_[blob_id], i);
+    }
+    for (int blob_id : top_id_vecs_[i]) {
+      blob_life_time_[blob_id] = std::max(blob_life_time_[blob_id], i + 1);
+    }
+  }
+  for (size_t blob_id = 0; blob_id < blobs_.size(); ++blob_id) {
+    if (blob_pinned_[blob_id]) {
+      blob_life_time_[blob_id] = num_layers;
+    }
+  }
+  for (int blob_id : requested_outputs_) {
+    blob_life_time_[blob_id] = num_layers;
+  }
+}
+
+void Net::SetExternalData(const string& blob_name, real_t* data) {
+  auto it = blob_names_index_.find(blob_name);
+  if (it == blob_names_index_.end()) {
+    LOG(FATAL) << "blob (" << blob_name << ") is not availiable in Net";
+  }
+  const int blob_id = it->second;
+  // never release the bound memory during forward
+  blob_life_time_[blob_id] = layers_.size();
+  blob_pinned_[blob_id] = true;
+  blobs_[blob_id]->set_cpu_data(data);
+}
+
+void Net::SetInputImage(const string& blob_name, const unsigned char* image,
+                        int height, int width, int channels, int n) {
+  auto it = blob_names_index_.find(blob_name);
+  if (it == blob_names_index_.end()) {
+    LOG(FATAL) << "blob (" << blob_name << ") is not availiable in Net";
+  }
+  const int blob_id = it->second;
+  const int layer_id = FindProducers()[blob_id];
+  CHECK(layer_id >= 0 && string(layers_[layer_id]->type()) == "Input")
+      << "blob (" << blob_name << ") is not a Net input";
+  const TransformationParameter& param =
+      layers_[layer_id]->layer_param().transform_param();
+  const int num_mean = param.mean_value_size();
+  CHECK(num_mean == 0 || num_mean == 1 || num_mean == channels)
+      << "Specify mean_value once or once per channel of the image";
+  vector<real_t> mean(channels, 0);
+  for (int c = 0; c < num_mean && c < channels; ++c) {
+    mean[c] = param.mean_value(c);
+  }
+  if (num_mean == 1) {
+    std::fill(mean.begin(), mean.end(), param.mean_value(0));
+  }
+  vector<int> order(param.channel_swap().begin(), param.channel_swap().end());
+  CHECK(order.empty() || static_cast<int>(order.size()) == channels)
+      << "Specify channel_swap once per channel of the image";
+  Blob* blob = blobs_[blob_id].get();
+  if (blob->num_axes() != 4 || blob->channels() != channels ||
+      blob->height() != height || blob->width() != width) {
+    blob->Reshape(blob->num_axes() > 0 ? blob->shape(0) : 1,
+                  channels, height, width);
   }
+  blob->SetImage(n, image, height, width, channels, &mean[0], param.scale(),
+                 order.empty() ? NULL : &order[0]);
 }
 
 void Net::CopyTrainedLayersFrom(const string& trained_filename) {
@@ -1,5 +1,15 @@
+#include <algorithm>
+#include <atomic>
 #include <sstream>
 #include <iomanip>
+#include <mutex>
+#include <new>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif  // _MSC_VER
+#ifdef __linux__
+#include <sys/mman.h>
+#endif  // __linux__
 #include "./common.hpp"
 #include "./syncedmem.hpp"
 #include "./util/math_functions.hpp"
@@ -25,7 +35,7 @@ static void CaffeFreeDevice(MemBlock block) {
 }
 
 SyncedMemory::~SyncedMemory() {
-  if (cpu_block_.ptr) {
+  if (cpu_block_.ptr && own_cpu_data_) {
     CaffeFreeHost(cpu_block_);
     cpu_block_.ptr = nullptr;
   }
@@ -37,6 +47,18 @@ SyncedMemory::~SyncedMemory() {
 #endif  // USE_CUDA
 }
 
+void SyncedMemory::set_cpu_data(void* data) {
+  CHECK(data) << "External data should not be null";
+  if (cpu_block_.ptr && own_cpu_data_) {
+    CaffeFreeHost(cpu_block_);
+  }
+  cpu_block_ = MemBlock();
+  cpu_block_.size = size_;
+  cpu_block_.ptr = data;
+  head_ = HEAD_AT_CPU;
+  own_cpu_data_ = false;
+}
+
 inline void SyncedMemory::to_cpu() {
   switch (head_) {
   case UNINITIALIZED:
@@ -120,12 +142,204 @@ void* SyncedMemory::mutable_gpu_data() {
 #endif  // USE_CUDA
 }
 
+//// cpu allocation
+
+static void* AlignedAlloc(size_t size, size_t alignment) {
+  void* ptr = nullptr;
+#ifdef _MSC_VER
+  ptr = _aligned_malloc(size, alignment);
+#else
+  if (posix_memalign(&ptr, alignment, size) != 0) {
+    ptr = nullptr;
+  }
+#endif  // _MSC_VER
+  CHECK(ptr != nullptr) << "Failed to allocate " << size << " bytes cpu memory";
+  return ptr;
+}
+
+static void AlignedFree(void* ptr) {
+#ifdef _MSC_VER
+  _aligned_free(ptr);
+#else
+  free(ptr);
+#endif  // _MSC_VER
+}
+
+/*!
+ * \brief allocate cpu memory for block.size bytes following the policy,
+ *  block.size is rounded up to huge page size if huge pages are used
+ */
+static void AllocHost(MemBlock& block, const MemPoolPolicy& policy) {
+  block.mapped = false;
+  if (policy.huge_page_threshold == 0 ||
+      block.size < policy.huge_page_threshold) {
+    block.ptr = AlignedAlloc(block.size, policy.alignment);
+    return;
+  }
+  const size_t huge = MemoryPool::kHugePageSize;
+  block.size = (block.size + huge - 1) / huge * huge;
+#if defined(__linux__) && defined(MAP_HUGETLB)
+  if (policy.use_hugetlbfs) {
+    void* ptr = mmap(nullptr, block.size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED) {
+      block.ptr = ptr;
+      block.mapped = true;
+      return;
+    }
+    // no reserved huge pages, fall back to transparent huge pages
+  }
+#endif  // __linux__ && MAP_HUGETLB
+  block.ptr = AlignedAlloc(block.size, huge);
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  // only a hint, fails silently if transparent huge pages are disabled
+  madvise(block.ptr, block.size, MADV_HUGEPAGE);
+#endif  // __linux__ && MADV_HUGEPAGE
+}
+
+static void FreeHost(const MemBlock& block) {
+#ifdef __linux__
+  if (block.mapped) {
+    munmap(block.ptr, block.size);
+    return;
+  }
+#endif  // __linux__
+  AlignedFree(block.ptr);
+}
+
+//// MemoryPool
+
+// policy of pools created later, guarded by policy_mutex
+static MemPoolPolicy default_policy[2] = {
+  {64, 0, false},  // kActivationArena
+  {64, 0, false},  // kWeightArena
+};
+static int64_t default_retain_limit = -1;
+static std::mutex policy_mutex;
+
+/*!
+ * \brief size class of a large cpu block, sizes in (2^k, 2^(k+1)] are split
+ *  into kBinsPerLevel classes of equal step
+ * \param size requested size, > kElementSize
+ * \param class_size size of the class, >= size
+ * \return bin index of the class
+ */
+static int SizeClass(size_t size, size_t* class_size) {
+  const size_t n = size - 1;
+  int k = 0;
+#ifdef __GNUC__
+  k = 63 - __builtin_clzll(static_cast<unsigned long long>(n));
+#else
+  while ((n >> (k + 1)) != 0) ++k;
+#endif  // __GNUC__
+  const size_t base = static_cast<size_t>(1) << k;
+  const size_t step = base / MemoryPool::kBinsPerLevel;
+  const size_t j = (n - base) / step;
+  *class_size = base + (j + 1) * step;
+  return (k - 7) * MemoryPool::kBinsPerLevel + static_cast<int>(j);
+}
+
+//// CentralPool
+
+/*!
+ * \brief process wide free lists of cpu blocks, sharded by size class so
+ *  threads asking for different sizes do not contend on the same lock
+ */
+class CentralPool {
+ public:
+  enum {
+    kNumShards = 16,
+  };
+  using FreeNode = MemoryPool::FreeNode;
+
+  static CentralPool* Get() {
+    // never destroyed, thread caches may flush into it at exit
+    static CentralPool* inst = new CentralPool();
+    return inst;
+  }
+  /*! \brief take a block of given arena and size class */
+  bool Pop(int arena, int bin, MemBlock* block) {
+    Shard& shard = shards_[bin % kNumShards];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    FreeNode* node = shard.bins[arena][bin];
+    if (node == nullptr) return false;
+    shard.bins[arena][bin] = node->next;
+    *block = node->block;
+    unused_cpu_mem -= block->size;
+    return true;
+  }
+  /*! \brief put an unused block, which is still counted as unused */
+  void Push(const MemBlock& block) {
+    Shard& shard = shards_[block.bin % kNumShards];
+    FreeNode* node = new (block.ptr) FreeNode;
+    node->block = block;
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    node->next = shard.bins[block.arena][block.bin];
+    shard.bins[block.arena][block.bin] = node;
+  }
+  /*! \brief free all blocks */
+  void Clear() {
+    for (int i = 0; i < kNumShards; ++i) {
+      Shard& shard = shards_[i];
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      for (int arena = 0; arena < 2; ++arena) {
+        for (int bin = 0; bin < MemoryPool::kNumBins; ++bin) {
+          FreeNode* node = shard.bins[arena][bin];
+          while (node != nullptr) {
+            MemBlock block = node->block;
+            node = node->next;
+            FreeHost(block);
+            cpu_mem -= block.size;
+            unused_cpu_mem -= block.size;
+          }
+          shard.bins[arena][bin] = nullptr;
+        }
+      }
+    }
+  }
+
+  //// memory in global mode, unused includes blocks cached by threads
+  std::atomic<int64_t> cpu_mem;
+  std::atomic<int64_t> unused_cpu_mem;
+
+ private:
+  CentralPool() : cpu_mem(0), unused_cpu_mem(0) {
+    for (int i = 0; i < kNumShards; ++i) {
+      for (int bin = 0; bin < MemoryPool::kNumBins; ++bin) {
+        shards_[i].bins[0][bin] = shards_[i].bins[1][bin] = nullptr;
+      }
+    }
+  }
+
+  struct Shard {
+    std::mutex mutex;
+    FreeNode* bins[2][MemoryPool::kNumBins];
+  };
+  Shard shards_[kNumShards];
+};
+
+static std::atomic<bool> use_global(false);
+
+#if !defined(_MSC_VER) || _MSC_VER >= 1900
+/*! \brief hands the cache of an exiting thread over to the central pool */
+struct ThreadCacheFlusher {
+  ~ThreadCacheFlusher() {
+    MemoryPool::Get()->Trim(0);
+  }
+};
+#define CAFFE_FLUSH_THREAD_CACHE_AT_EXIT
+#endif  // thread_local support
+
 //// MemoryPool
 
 MemoryPool* MemoryPool::Get() {
   return ThreadLocalStore<MemoryPool>::Get();
 }
 
+void MemoryPool::UseGlobal(bool global) {
+  use_global.store(global);
+}
+
 MemoryPool::MemoryPool() {
   // init small object pool
   head_ = nullptr;
@@ -137,6 +351,18 @@ MemoryPool::MemoryPool() {
   // init status
   st_.cpu_mem = st_.unused_cpu_mem = 0;
   st_.gpu_mem = st_.unused_gpu_mem = 0;
+  // init large object pool
+  for (int i = 0; i < kNumBins; ++i) {
+    bins_[kActivationArena][i] = bins_[kWeightArena][i] = nullptr;
+  }
+  lru_head_ = lru_tail_ = nullptr;
+  cached_ = 0;
+  // init arena
+  arena_ = kActivationArena;
+  std::lock_guard<std::mutex> lock(policy_mutex);
+  policy_[kActivationArena] = default_policy[kActivationArena];
+  policy_[kWeightArena] = default_policy[kWeightArena];
+  retain_limit_ = default_retain_limit;
 }
 
 MemoryPool::~MemoryPool() {
@@ -144,7 +370,30 @@ MemoryPool::~MemoryPool() {
   Clear();
   // small object pool
   for (auto& block : obj_pool_) {
-    free(block.ptr);
+    AlignedFree(block.ptr);
+  }
+}
+
+MemArena MemoryPool::SwitchArena(MemArena arena) {
+  MemArena prev = arena_;
+  arena_ = arena;
+  return prev;
+}
+
+void MemoryPool::SetPolicy(MemArena arena, const MemPoolPolicy& policy) {
+  CHECK(arena == kActivationArena || arena == kWeightArena)
+      << "Unknown memory arena " << arena;
+  CHECK(policy.alignment >= static_cast<int>(sizeof(void*)) &&
+        (policy.alignment & (policy.alignment - 1)) == 0)
+      << "Memory alignment should be a power of 2 and at least "
+      << sizeof(void*) << ", got " << policy.alignment;
+  policy_[arena] = policy;
+}
+
+void MemoryPool::SetRetainLimit(int64_t limit) {
+  retain_limit_ = limit;
+  if (retain_limit_ >= 0) {
+    Trim(retain_limit_);
   }
 }
 
@@ -174,7 +423,8 @@ inline bool ShouldBorrowMem(size_t has, size_t wants) {
 
 MemBlock MemoryPool::RequestCPU(size_t size) {
   MemBlock block;
-  if (size <= kElementSize) {  // small object <= 128 bytes
+  const bool global = use_global.load(std::memory_order_relaxed);
+  if (size <= kElementSize && !global) {  // small object <= 128 bytes
     block.device = -1;
     block.size = size;
     if (head_ != nullptr) {
@@ -189,7 +439,7 @@ MemBlock MemoryPool::RequestCPU(size_t size) {
       else {
         curr_page_.device = -1;
         curr_page_.size = kPageSize;
-        curr_page_.ptr = malloc(kPageSize);
+        curr_page_.ptr = AlignedAlloc(kPageSize, policy_[kActivationArena].alignment);
         st_.cpu_mem += kPageSize;
         obj_pool_.push_back(curr_page_);
         block.ptr = curr_page_.ptr;
@@ -198,21 +448,41 @@ MemBlock MemoryPool::RequestCPU(size_t size) {
     }
   }
   else {
-    CpuKey key{size};
-    auto it = cpu_pool_.lower_bound(key);
-    if (it == cpu_pool_.end() || !ShouldBorrowMem(it->second.size, size)) {
-      block.device = -1;
-      block.size = size;
-      block.ptr = malloc(size);
-      st_.cpu_mem += size;
-      //DLOG(INFO) << "[CPU] Requested " << MemSize(size) << ", Create " << MemSize(block.size);
+    // small objects take the smallest class in global mode, so they can be
+    // passed between threads like other blocks
+    size = std::max<size_t>(size, kElementSize + 1);
+    size_t class_size;
+    const int bin = SizeClass(size, &class_size);
+    // a block of the next class is at most 25% larger, borrow it as well
+    const int last_bin = std::min(bin + 1, kNumBins - 1);
+    for (int b = bin; b <= last_bin; ++b) {
+      FreeNode* node = bins_[arena_][b];
+      if (node != nullptr) {
+        block = node->block;
+        Unlink(node);
+        cached_ -= block.size;
+        if (global) {
+          CentralPool::Get()->unused_cpu_mem -= block.size;
+        }
+        //DLOG(INFO) << "[CPU] Requested " << MemSize(size) << ", Get " << MemSize(block.size);
+        return block;
+      }
+    }
+    if (global && CentralPool::Get()->Pop(arena_, bin, &block)) {
+      return block;
+    }
+    block.device = -1;
+    block.arena = arena_;
+    block.bin = bin;
+    block.size = class_size;
+    AllocHost(block, policy_[arena_]);
+    if (global) {
+      CentralPool::Get()->cpu_mem += block.size;
     }
     else {
-      block = it->second;
-      cpu_pool_.erase(it);
-      st_.unused_cpu_mem -= block.size;
-      //DLOG(INFO) << "[CPU] Requested " << MemSize(size) << ", Get " << MemSize(block.size);
+      st_.cpu_mem += block.size;
     }
+    //DLOG(INFO) << "[CPU] Requested " << MemSize(size) << ", Create " << MemSize(block.size);
   }
   return block;
 }
@@ -224,10 +494,59 @@ void MemoryPool::ReturnCPU(MemBlock block) {
     head_ = p;
   }
   else {
-    CpuKey key{block.size};
-    cpu_pool_.insert(std::make_pair(key, block));
-    st_.unused_cpu_mem += block.size;
+    FreeNode* node = new (block.ptr) FreeNode;
+    node->block = block;
+    // push front of size class
+    FreeNode*& head = bins_[block.arena][block.bin];
+    node->prev = nullptr;
+    node->next = head;
+    if (head != nullptr) head->prev = node;
+    head = node;
+    // push front of LRU list
+    node->lru_prev = nullptr;
+    node->lru_next = lru_head_;
+    if (lru_head_ != nullptr) lru_head_->lru_prev = node;
+    else lru_tail_ = node;
+    lru_head_ = node;
+    cached_ += block.size;
+    if (use_global.load(std::memory_order_relaxed)) {
+      CentralPool::Get()->unused_cpu_mem += block.size;
+#ifdef CAFFE_FLUSH_THREAD_CACHE_AT_EXIT
+      static thread_local ThreadCacheFlusher flusher;
+      (void)flusher;
+#endif  // CAFFE_FLUSH_THREAD_CACHE_AT_EXIT
+    }
     //DLOG(INFO) << "[CPU] Return " << MemSize(block.size);
+    if (retain_limit_ >= 0 && cached_ > retain_limit_) {
+      Trim(retain_limit_);
+    }
+  }
+}
+
+void MemoryPool::Unlink(FreeNode* node) {
+  if (node->prev != nullptr) node->prev->next = node->next;
+  else bins_[node->block.arena][node->block.bin] = node->next;
+  if (node->next != nullptr) node->next->prev = node->prev;
+  if (node->lru_prev != nullptr) node->lru_prev->lru_next = node->lru_next;
+  else lru_head_ = node->lru_next;
+  if (node->lru_next != nullptr) node->lru_next->lru_prev = node->lru_prev;
+  else lru_tail_ = node->lru_prev;
+}
+
+void MemoryPool::Trim(int64_t limit) {
+  const bool global = use_global.load(std::memory_order_relaxed);
+  while (lru_tail_ != nullptr && cached_ > limit) {
+    MemBlock block = lru_tail_->block;
+    Unlink(lru_tail_);
+    cached_ -= block.size;
+    if (global) {
+      // other threads may reuse it
+      CentralPool::Get()->Push(block);
+    }
+    else {
+      FreeHost(block);
+      st_.cpu_mem -= block.size;
+    }
   }
 }
 
@@ -278,12 +597,10 @@ void MemoryPool::ReturnGPU(MemBlock block) {
 }
 
 void MemoryPool::Clear() {
-  for (auto it = cpu_pool_.begin(); it != cpu_pool_.end(); ++it) {
-    free(it->second.ptr);
-    st_.cpu_mem -= it->second.size;
-    st_.unused_cpu_mem -= it->second.size;
+  Trim(0);
+  if (use_global.load()) {
+    CentralPool::Get()->Clear();
   }
-  cpu_pool_.clear();
 #ifdef USE_CUDA
   int cur_device;
   cudaError_t err = cudaGetDevice(&cur_device);
@@ -310,12 +627,21 @@ void MemoryPool::Clear() {
 }
 
 MemPoolState MemoryPool::GetState() {
-  int unused_cpu_mem = 0;
-  int unused_gpu_mem = 0;
-  for (auto it = cpu_pool_.begin(); it != cpu_pool_.end(); ++it) {
-    unused_cpu_mem += it->second.size;
+  int64_t unused_cpu_mem = 0;
+  int64_t unused_gpu_mem = 0;
+  for (FreeNode* node = lru_head_; node != nullptr; node = node->lru_next) {
+    unused_cpu_mem += node->block.size;
+  }
+  CHECK_EQ(unused_cpu_mem, cached_);
+  if (use_global.load()) {
+    // process wide, small object pages are still owned by threads
+    CentralPool* central = CentralPool::Get();
+    MemPoolState st = st_;
+    st.cpu_mem += central->cpu_mem.load();
+    st.unused_cpu_mem = central->unused_cpu_mem.load();
+    return st;
   }
-  CHECK_EQ(unused_cpu_mem, st_.unused_cpu_mem);
+  st_.unused_cpu_mem = cached_;
 #ifdef USE_CUDA
   for (auto it = gpu_pool_.begin(); it != gpu_pool_.end(); ++it) {
     unused_gpu_mem += it->second.size;
@@ -333,4 +659,28 @@ MemPoolState MemPoolGetState() {
   return MemoryPool::Get()->GetState();
 }
 
+void MemPoolSetPolicy(MemArena arena, const MemPoolPolicy& policy) {
+  MemoryPool::Get()->SetPolicy(arena, policy);
+  std::lock_guard<std::mutex> lock(policy_mutex);
+  default_policy[arena] = policy;
+}
+
+void MemPoolSetRetainLimit(int64_t bytes) {
+  MemoryPool::Get()->SetRetainLimit(bytes);
+  std::lock_guard<std::mutex> lock(policy_mutex);
+  default_retain_limit = bytes;
+}
+
+void MemPoolUseGlobal(int64_t thread_cache) {
+  CHECK_GE(thread_cache, 0) << "thread cache size should not be negative";
+  MemoryPool::UseGlobal(true);
+  MemPoolSetRetainLimit(thread_cache);
+}
+
+MemPoolPolicy MemPoolGetPolicy(MemArena arena) {
+  CHECK(arena == kActivationArena || arena == kWeightArena)
+      << "Unknown memory arena " << arena;
+  return MemoryPool::Get()->GetPolicy(arena);
+}
+
 }  // namespace caffe
@@ -18,12 +18,21 @@ class MemoryPool {
   enum {
     kElementSize = 128,
     kPageSize = 1 << 20,  // 1 MB
+    kHugePageSize = 2 << 20,  // 2 MB
+  };
+  // size classes of large cpu blocks, every power of 2 is split into
+  // kBinsPerLevel geometric steps, so a block wastes at most 25% memory
+  enum {
+    kBinsPerLevel = 4,
+    kNumBins = (64 - 7) * kBinsPerLevel,
   };
 
   using GpuKey = std::pair<int, size_t>;
-  using CpuKey = size_t;
   struct MemBlock {
     int device{-1};
+    int arena{kActivationArena};
+    int bin{-1};  // size class of cpu block
+    bool mapped{false};  // mapped from hugetlbfs, released by munmap
     size_t size{0};
     void* ptr{nullptr};
   };
@@ -50,15 +59,60 @@ class MemoryPool {
   MemPoolState GetState();
   /*! \brief free all unused memory in pool */
   void Clear();
+  /*!
+   * \brief free least recently returned cpu blocks until unused memory
+   *  is no more than limit bytes
+   */
+  void Trim(int64_t limit);
+  /*! \brief set limit of unused cpu memory, negative for no limit */
+  void SetRetainLimit(int64_t limit);
+  /*!
+   * \brief switch all threads between thread local pools and the process wide
+   *  pool, in which every thread local pool caches blocks for the central
+   *  free lists shared by all threads
+   */
+  static void UseGlobal(bool global);
+  /*!
+   * \brief switch the arena of following cpu requests
+   * \param arena arena to use
+   * \return previous arena
+   */
+  MemArena SwitchArena(MemArena arena);
+  /*! \brief set allocation policy of an arena */
+  void SetPolicy(MemArena arena, const MemPoolPolicy& policy);
+  /*! \brief get allocation policy of an arena */
+  MemPoolPolicy GetPolicy(MemArena arena) const { return policy_[arena]; }
 
  private:
   friend ThreadLocalStore<MemoryPool>;
+  friend class CentralPool;
   MemoryPool();
   ~MemoryPool();
   DISABLE_COPY_AND_ASSIGN(MemoryPool);
 
+  /*!
+   * \brief header written into an unused cpu block, links the block into
+   *  the free list of its size class and into the LRU list of all unused
+   *  blocks, so request and return never allocate
+   */
+  struct FreeNode {
+    FreeNode* prev;
+    FreeNode* next;
+    FreeNode* lru_prev;
+    FreeNode* lru_next;
+    MemBlock block;
+  };
+  static_assert(sizeof(FreeNode) <= kElementSize,
+                "FreeNode must fit in a large block");
+  /*! \brief unlink a node from its size class and LRU list */
+  void Unlink(FreeNode* node);
+
   //// pool for unused memory
-  std::multimap<CpuKey, MemBlock> cpu_pool_;
+  FreeNode* bins_[2][kNumBins];  // per arena free lists, most recent first
+  FreeNode* lru_head_;  // most recently returned
+  FreeNode* lru_tail_;  // least recently returned
+  int64_t cached_;  // bytes of unused blocks in this pool
+  int64_t retain_limit_;
   std::multimap<GpuKey, MemBlock> gpu_pool_;
 
   //// small object pool on CPU for size <= 128 bytes
@@ -72,13 +126,41 @@ class MemoryPool {
 
   //// memory pool status
   MemPoolState st_;
+
+  //// arena for cpu requests and allocation policy of every arena
+  MemArena arena_;
+  MemPoolPolicy policy_[2];
+};
+
+/*!
+ * \brief RAII helper to place cpu memory requested in current thread into
+ *  an arena during its lifetime
+ */
+class MemArenaScope {
+ public:
+  explicit MemArenaScope(MemArena arena)
+      : prev_(MemoryPool::Get()->SwitchArena(arena)) {}
+  ~MemArenaScope() {
+    MemoryPool::Get()->SwitchArena(prev_);
+  }
+
+ private:
+  MemArena prev_;
+  DISABLE_COPY_AND_ASSIGN(MemArenaScope);
 };
 
 class SyncedMemory {
  public:
   explicit SyncedMemory(size_t size)
-      : cpu_block_(), gpu_block_(), size_(size), head_(UNINITIALIZED) {}
+      : cpu_block_(), gpu_block_(), size_(size), head_(UNINITIALIZED),
+        own_cpu_data_(true) {}
   ~SyncedMemory();
+  /*!
+   * \brief use memory owned by the caller as cpu data, it must hold size()
+   *  bytes and outlive this object, SyncedMemory never frees it
+   */
+  void set_cpu_data(void* data);
+  bool own_cpu_data() const { return own_cpu_data_; }
   const void* cpu_data();
   const void* gpu_data();
   void* mutable_cpu_data();
@@ -94,6 +176,7 @@ class SyncedMemory {
   MemoryPool::MemBlock gpu_block_;
   size_t size_;
   SyncedHead head_;
+  bool own_cpu_data_;
 
   DISABLE_COPY_AND_ASSIGN(SyncedMemory);
 };  // class SyncedMemory
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <vector>
 
 #include "./im2col.hpp"
@@ -15,38 +16,60 @@ inline bool is_a_ge_zero_and_a_lt_b(int a, int b) {
   return static_cast<unsigned>(a) < static_cast<unsigned>(b);
 }
 
+// Output columns [*begin, *end) whose kernel tap, at offset
+// -pad + kernel_index * dilation, reads inside an image axis of length size.
+// Columns before and after the range only see padding.
+inline void valid_output_range(int offset, int stride, int size, int output,
+                               int* begin, int* end) {
+  int b = offset >= 0 ? 0 : (stride - 1 - offset) / stride;
+  int e = offset >= size ? 0 : (size - 1 - offset) / stride + 1;
+  b = std::min(b, output);
+  *begin = b;
+  *end = std::max(b, std::min(e, output));
+}
+
 template <typename Dtype>
-void im2col_cpu(const Dtype* data_im, const int channels,
+void im2col_panel_cpu(const Dtype* data_im, const int channels,
     const int height, const int width, const int kernel_h, const int kernel_w,
     const int pad_h, const int pad_w,
     const int stride_h, const int stride_w,
     const int dilation_h, const int dilation_w,
+    const int row_begin, const int row_end,
     Dtype* data_col) {
-  const int output_h = (height + 2 * pad_h -
-    (dilation_h * (kernel_h - 1) + 1)) / stride_h + 1;
   const int output_w = (width + 2 * pad_w -
     (dilation_w * (kernel_w - 1) + 1)) / stride_w + 1;
   const int channel_size = height * width;
   for (int channel = channels; channel--; data_im += channel_size) {
     for (int kernel_row = 0; kernel_row < kernel_h; kernel_row++) {
       for (int kernel_col = 0; kernel_col < kernel_w; kernel_col++) {
-        int input_row = -pad_h + kernel_row * dilation_h;
-        for (int output_rows = output_h; output_rows; output_rows--) {
+        const int offset = -pad_w + kernel_col * dilation_w;
+        int begin, end;
+        valid_output_range(offset, stride_w, width, output_w, &begin, &end);
+        int input_row = -pad_h + kernel_row * dilation_h +
+                        row_begin * stride_h;
+        for (int output_row = row_begin; output_row < row_end; output_row++) {
           if (!is_a_ge_zero_and_a_lt_b(input_row, height)) {
-            for (int output_cols = output_w; output_cols; output_cols--) {
-              *(data_col++) = 0;
-            }
+            std::fill(data_col, data_col + output_w, Dtype(0));
           } else {
-            int input_col = -pad_w + kernel_col * dilation_w;
-            for (int output_col = output_w; output_col; output_col--) {
-              if (is_a_ge_zero_and_a_lt_b(input_col, width)) {
-                *(data_col++) = data_im[input_row * width + input_col];
-              } else {
-                *(data_col++) = 0;
+            // padding on both ends, the interior is a copy for stride 1
+            // and a fixed stride gather otherwise
+            const Dtype* src = data_im + input_row * width;
+            std::fill(data_col, data_col + begin, Dtype(0));
+            if (stride_w == 1) {
+              std::copy(src + offset + begin, src + offset + end,
+                        data_col + begin);
+            } else if (stride_w == 2) {
+              for (int i = begin; i < end; ++i) {
+                data_col[i] = src[offset + 2 * i];
+              }
+            } else {
+              for (int i = begin; i < end; ++i) {
+                data_col[i] = src[offset + i * stride_w];
               }
-              input_col += stride_w;
             }
+            std::fill(data_col + end, data_col + output_w, Dtype(0));
           }
+          data_col += output_w;
           input_row += stride_h;
         }
       }
@@ -54,6 +77,28 @@ void im2col_cpu(const Dtype* data_im, const int channels,
   }
 }
 
+// Explicit instantiation
+template void im2col_panel_cpu<float>(const float* data_im,
+    const int channels, const int height, const int width,
+    const int kernel_h, const int kernel_w, const int pad_h, const int pad_w,
+    const int stride_h, const int stride_w,
+    const int dilation_h, const int dilation_w,
+    const int row_begin, const int row_end, float* data_col);
+
+template <typename Dtype>
+void im2col_cpu(const Dtype* data_im, const int channels,
+    const int height, const int width, const int kernel_h, const int kernel_w,
+    const int pad_h, const int pad_w,
+    const int stride_h, const int stride_w,
+    const int dilation_h, const int dilation_w,
+    Dtype* data_col) {
+  const int output_h = (height + 2 * pad_h -
+    (dilation_h * (kernel_h - 1) + 1)) / stride_h + 1;
+  im2col_panel_cpu(data_im, channels, height, width, kernel_h, kernel_w,
+                   pad_h, pad_w, stride_h, stride_w, dilation_h, dilation_w,
+                   0, output_h, data_col);
+}
+
 // Explicit instantiation
 template void im2col_cpu<float>(const float* data_im, const int channels,
     const int height, const int width, const int kernel_h, const int kernel_w,
@@ -165,20 +210,24 @@ void col2im_cpu(const Dtype* data_col, const int channels,
   for (int channel = channels; channel--; data_im += channel_size) {
     for (int kernel_row = 0; kernel_row < kernel_h; kernel_row++) {
       for (int kernel_col = 0; kernel_col < kernel_w; kernel_col++) {
+        const int offset = -pad_w + kernel_col * dilation_w;
+        int begin, end;
+        valid_output_range(offset, stride_w, width, output_w, &begin, &end);
         int input_row = -pad_h + kernel_row * dilation_h;
         for (int output_rows = output_h; output_rows; output_rows--) {
-          if (!is_a_ge_zero_and_a_lt_b(input_row, height)) {
-            data_col += output_w;
-          } else {
-            int input_col = -pad_w + kernel_col * dilation_w;
-            for (int output_col = output_w; output_col; output_col--) {
-              if (is_a_ge_zero_and_a_lt_b(input_col, width)) {
-                data_im[input_row * width + input_col] += *data_col;
+          if (is_a_ge_zero_and_a_lt_b(input_row, height)) {
+            Dtype* dst = data_im + input_row * width;
+            if (stride_w == 1) {
+              for (int i = begin; i < end; ++i) {
+                dst[offset + i] += data_col[i];
+              }
+            } else {
+              for (int i = begin; i < end; ++i) {
+                dst[offset + i * stride_w] += data_col[i];
               }
-              data_col++;
-              input_col += stride_w;
             }
           }
+          data_col += output_w;
           input_row += stride_h;
         }
       }
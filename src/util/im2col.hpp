@@ -16,6 +16,17 @@ void im2col_cpu(const Dtype* data_im, const int channels,
     const int stride_w, const int dilation_h, const int dilation_w,
     Dtype* data_col);
 
+/*!
+ * \brief im2col_cpu of output rows [row_begin, row_end) only, fills the
+ *  (row_end - row_begin) * output_w columns of those rows
+ */
+template <typename Dtype>
+void im2col_panel_cpu(const Dtype* data_im, const int channels,
+    const int height, const int width, const int kernel_h, const int kernel_w,
+    const int pad_h, const int pad_w, const int stride_h,
+    const int stride_w, const int dilation_h, const int dilation_w,
+    const int row_begin, const int row_end, Dtype* data_col);
+
 template <typename Dtype>
 void col2im_nd_cpu(const Dtype* data_col, const int num_spatial_axes,
     const int* im_shape, const int* col_shape,
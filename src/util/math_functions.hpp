@@ -17,6 +17,13 @@ void caffe_cpu_gemm(const CBLAS_TRANSPOSE TransA,
     const real_t alpha, const real_t* A, const real_t* B, const real_t beta,
     real_t* C);
 
+// caffe_cpu_gemm into the first N columns of C whose rows are ldc apart, for
+// writing a panel of a wider matrix.
+void caffe_cpu_gemm(const CBLAS_TRANSPOSE TransA,
+    const CBLAS_TRANSPOSE TransB, const int M, const int N, const int K,
+    const real_t alpha, const real_t* A, const real_t* B, const real_t beta,
+    real_t* C, const int ldc);
+
 void caffe_cpu_gemv(const CBLAS_TRANSPOSE TransA, const int M, const int N,
     const real_t alpha, const real_t* A, const real_t* x, const real_t beta,
     real_t* y);
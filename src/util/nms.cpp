@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "./nms.hpp"
+
+namespace caffe {
+
+vector<int> SortByScore(const real_t* scores, int num, int stride, int top_k) {
+  vector<int> index(num);
+  std::iota(index.begin(), index.end(), 0);
+  auto greater = [scores, stride](int a, int b) {
+    const real_t sa = scores[a * stride];
+    const real_t sb = scores[b * stride];
+    return sa > sb || (sa == sb && a < b);
+  };
+  if (top_k > 0 && top_k < num) {
+    std::partial_sort(index.begin(), index.begin() + top_k, index.end(),
+                      greater);
+    index.resize(top_k);
+  }
+  else {
+    std::sort(index.begin(), index.end(), greater);
+  }
+  return index;
+}
+
+vector<int> NonMaximumSuppression(const real_t* boxes, int stride,
+                                  const vector<int>& order, real_t threshold,
+                                  int max_keep, real_t offset) {
+  // boxes in visiting order, one array per coordinate so the overlaps of a
+  // kept box against all later ones run as a single branch free loop
+  const int num = order.size();
+  vector<real_t> x1(num), y1(num), x2(num), y2(num), area(num);
+  for (int i = 0; i < num; ++i) {
+    const real_t* box = boxes + order[i] * stride;
+    x1[i] = box[0];
+    y1[i] = box[1];
+    x2[i] = box[2];
+    y2[i] = box[3];
+    area[i] = (box[2] - box[0] + offset) * (box[3] - box[1] + offset);
+  }
+  vector<int> removed(num, 0);
+  vector<int> keep;
+  for (int i = 0; i < num; ++i) {
+    if (removed[i]) {
+      continue;
+    }
+    keep.push_back(order[i]);
+    if (max_keep > 0 && static_cast<int>(keep.size()) >= max_keep) {
+      break;
+    }
+    const real_t ix1 = x1[i], iy1 = y1[i], ix2 = x2[i], iy2 = y2[i];
+    const real_t iarea = area[i];
+    for (int j = i + 1; j < num; ++j) {
+      const real_t left = x1[j] > ix1 ? x1[j] : ix1;
+      const real_t top = y1[j] > iy1 ? y1[j] : iy1;
+      const real_t right = x2[j] < ix2 ? x2[j] : ix2;
+      const real_t bottom = y2[j] < iy2 ? y2[j] : iy2;
+      const real_t w = right - left + offset;
+      const real_t h = bottom - top + offset;
+      const real_t inter = (w > 0 ? w : 0) * (h > 0 ? h : 0);
+      // inter / union > threshold without the division
+      removed[j] |= inter > threshold * (iarea + area[j] - inter);
+    }
+  }
+  return keep;
+}
+
+}  // namespace caffe
@@ -0,0 +1,39 @@
+#ifndef CAFFE_UTIL_NMS_HPP_
+#define CAFFE_UTIL_NMS_HPP_
+
+#include <vector>
+
+#include "../common.hpp"
+
+namespace caffe {
+
+/*!
+ * \brief indices of the top_k highest scores in descending order, equal
+ *  scores are ordered by index
+ * \param scores score i is at scores + i * stride
+ * \param num number of scores
+ * \param stride distance between two scores
+ * \param top_k number of indices to return, all of them when top_k <= 0
+ */
+vector<int> SortByScore(const real_t* scores, int num, int stride, int top_k);
+
+/*!
+ * \brief greedy non maximum suppression
+ *  Boxes are visited in the given order, usually by descending score, and a
+ *  box is kept unless its IoU with a box kept before is above threshold.
+ * \param boxes box i is (x1, y1, x2, y2) at boxes + i * stride
+ * \param stride distance between two boxes
+ * \param order indices of the boxes to visit
+ * \param threshold IoU above which a box is suppressed
+ * \param max_keep stop after this many boxes, no limit when max_keep <= 0
+ * \param offset 1 for pixel coordinates as in Faster R-CNN, where a box
+ *  covers x2 - x1 + 1 pixels, 0 for continuous coordinates
+ * \return indices of the kept boxes, in visiting order
+ */
+vector<int> NonMaximumSuppression(const real_t* boxes, int stride,
+                                  const vector<int>& order, real_t threshold,
+                                  int max_keep, real_t offset);
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_NMS_HPP_
@@ -0,0 +1,49 @@
+#include <thread>
+#include <vector>
+
+#include <caffe/blob.hpp>
+
+using namespace std;
+using namespace caffe;
+
+// memory freed by one thread is reused by another through the central pool
+int main() {
+  // large enough to keep the block in the thread cache until the thread exits
+  const int64_t kThreadCache = 64 << 20;
+  const vector<int> kShape(1, 1 << 20);
+  caffe::MemPoolUseGlobal(kThreadCache);
+  MemPoolState st0 = caffe::MemPoolGetState();
+
+  // the cache of an exiting thread goes to the central pool
+  real_t *first = nullptr;
+  std::thread([&]() {
+    Blob blob(kShape);
+    first = blob.mutable_cpu_data();
+  }).join();
+  MemPoolState st1 = caffe::MemPoolGetState();
+  const int64_t size = st1.cpu_mem - st0.cpu_mem;
+  CHECK_GE(size, static_cast<int64_t>(kShape[0] * sizeof(real_t)));
+  CHECK_EQ(st1.unused_cpu_mem - st0.unused_cpu_mem, size);
+
+  // another thread takes the same block without allocating
+  real_t *second = nullptr;
+  MemPoolState in_use;
+  std::thread([&]() {
+    Blob blob(kShape);
+    second = blob.mutable_cpu_data();
+    in_use = caffe::MemPoolGetState();
+  }).join();
+  CHECK_EQ(second, first);
+  CHECK_EQ(in_use.unused_cpu_mem, st0.unused_cpu_mem);
+  MemPoolState st2 = caffe::MemPoolGetState();
+  CHECK_EQ(st2.cpu_mem, st1.cpu_mem);
+  CHECK_EQ(st2.unused_cpu_mem, st1.unused_cpu_mem);
+
+  // clearing frees the central free lists
+  caffe::MemPoolClear();
+  MemPoolState st3 = caffe::MemPoolGetState();
+  CHECK_EQ(st3.cpu_mem, st0.cpu_mem);
+  CHECK_EQ(st3.unused_cpu_mem, st0.unused_cpu_mem);
+  LOG(INFO) << "Global memory pool checked";
+  return 0;
+}
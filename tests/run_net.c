@@ -1,6 +1,7 @@
 #include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <caffe/c_api.h>
 
 #define CHECK(condition)                          \
@@ -66,8 +67,179 @@ int main(int argc, char *argv[]) {
                                      CaffeBlobHeight(blobs[i]),
                                      CaffeBlobWidth(blobs[i]));
   }
+  // bind external input and output buffers, results should not change
+  BlobHandle output = blobs[n - 1];
+  int output_count = CaffeBlobCount(output);
+  real_t *expected = malloc(output_count * sizeof(real_t));
+  real_t *input_buffer = malloc(count * sizeof(real_t));
+  real_t *output_buffer = malloc(output_count * sizeof(real_t));
+  data = CaffeBlobData(blob);
+  for (i = 0; i < count; i++) {
+    input_buffer[i] = data[i];
+  }
+  data = CaffeBlobData(output);
+  for (i = 0; i < output_count; i++) {
+    expected[i] = data[i];
+  }
+  // run in one call with precomputed handles
+  const real_t *run_inputs[] = { input_buffer };
+  real_t *run_outputs[] = { output_buffer };
+  int ndims[] = { 4 };
+  const int *shapes[] = { shape };
+  CHECK_SUCCESS(CaffeNetRun(net, 1, &blob, ndims, shapes, run_inputs,
+                            1, &output, &output_count, run_outputs));
+  for (i = 0; i < output_count; i++) {
+    CHECK(output_buffer[i] == expected[i]);
+    output_buffer[i] = 0;
+  }
+  output_count -= 1;
+  CHECK(CaffeNetRun(net, 1, &blob, NULL, NULL, run_inputs,
+                    1, &output, &output_count, run_outputs) == -1);
+  output_count += 1;
+  // prune layers after the first internal blob, then bring them back
+  CHECK_SUCCESS(CaffeNetSetOutputs(net, 1, &names[1]));
+  CHECK_SUCCESS(CaffeNetForward(net));
+  CHECK(CaffeBlobCount(output) == 0);
+  CHECK_SUCCESS(CaffeNetSetOutputs(net, 0, NULL));
+  CHECK_SUCCESS(CaffeNetForward(net));
+  data = CaffeBlobData(output);
+  for (i = 0; i < output_count; i++) {
+    CHECK(data[i] == expected[i]);
+  }
+  CHECK_SUCCESS(CaffeBlobSetExternalData(blob, input_buffer));
+  CHECK_SUCCESS(CaffeBlobSetExternalData(output, output_buffer));
+  CHECK(CaffeBlobData(blob) == input_buffer);
+  CHECK_SUCCESS(CaffeNetForward(net));
+  CHECK(CaffeBlobData(output) == output_buffer);
+  for (i = 0; i < output_count; i++) {
+    CHECK(output_buffer[i] == expected[i]);
+  }
+  // fill input from an interleaved 8-bit BGR image as RGB planes
+  unsigned char *image = malloc(count);
+  for (i = 0; i < count; i++) {
+    image[i] = (unsigned char)(rand() & 255);
+  }
+  real_t mean[] = { 123.f, 117.f, 104.f };
+  int order[] = { 2, 1, 0 };
+  CHECK_SUCCESS(CaffeBlobSetImage(blob, 0, image, height, width, channels,
+                                  mean, 1.f, order));
+  data = CaffeBlobData(blob);
+  CHECK(data[0] == image[2] - mean[0]);
+  CHECK(data[height * width + 1] == image[3 + 1] - mean[1]);
+  CHECK(data[2 * height * width + 2] == image[6 + 0] - mean[2]);
+  CHECK(CaffeBlobSetImage(blob, 1, image, height, width, channels,
+                          mean, 1.f, order) == -1);
+  free(image);
   // destroy
   CHECK_SUCCESS(CaffeNetDestroy(net));
+  free(expected);
+  free(input_buffer);
+  free(output_buffer);
+
+  // outputs bound through the blob keep being written, neither the in-place
+  // Sigmoid nor the Concat view may hand them memory of the net
+  const char *bound_net =
+    "layer { name: 'data' type: 'Input' top: 'data'"
+    "  input_param { shape { dim: 1 dim: 2 dim: 3 dim: 3 } } }"
+    "layer { name: 'p' type: 'Power' bottom: 'data' top: 'p'"
+    "  power_param { scale: 2 } }"
+    "layer { name: 'r' type: 'ReLU' bottom: 'p' top: 'r' }"
+    "layer { name: 's' type: 'Sigmoid' bottom: 'r' top: 's' }"
+    "layer { name: 'q' type: 'Power' bottom: 'data' top: 'q' }"
+    "layer { name: 'c' type: 'Concat' bottom: 'q' bottom: 'data' top: 'c' }"
+    "layer { name: 'f' type: 'Flatten' bottom: 'q' top: 'f' }"
+    "layer { name: 'rs' type: 'Reshape' bottom: 'q' top: 'rs'"
+    "  reshape_param { shape { dim: 0 dim: -1 } } }"
+    "layer { name: 'sl' type: 'Slice' bottom: 'q' top: 'sl' }";
+  CHECK_SUCCESS(CaffeNetCreateFromBuffer(bound_net, (int)strlen(bound_net),
+                                         NULL, 0, &net));
+  BlobHandle bound[2];
+  CHECK_SUCCESS(CaffeNetGetBlob(net, "data", &blob));
+  CHECK_SUCCESS(CaffeNetGetBlob(net, "s", &bound[0]));
+  CHECK_SUCCESS(CaffeNetGetBlob(net, "c", &bound[1]));
+  data = CaffeBlobData(blob);
+  for (i = 0; i < CaffeBlobCount(blob); i++) {
+    data[i] = (real_t)(i - 9);
+  }
+  CHECK_SUCCESS(CaffeNetForward(net));
+  real_t *bound_expected[2], *bound_buffer[2];
+  int k;
+  for (k = 0; k < 2; k++) {
+    int bound_count = CaffeBlobCount(bound[k]);
+    bound_expected[k] = malloc(bound_count * sizeof(real_t));
+    bound_buffer[k] = malloc(bound_count * sizeof(real_t));
+    data = CaffeBlobData(bound[k]);
+    for (i = 0; i < bound_count; i++) {
+      bound_expected[k][i] = data[i];
+    }
+    CHECK_SUCCESS(CaffeBlobSetExternalData(bound[k], bound_buffer[k]));
+    int iter;
+    for (iter = 0; iter < 2; iter++) {
+      for (i = 0; i < bound_count; i++) {
+        bound_buffer[k][i] = -999.f;
+      }
+      CHECK_SUCCESS(CaffeNetForward(net));
+      CHECK(CaffeBlobData(bound[k]) == bound_buffer[k]);
+      for (i = 0; i < bound_count; i++) {
+        CHECK(bound_buffer[k][i] == bound_expected[k][i]);
+      }
+    }
+  }
+  // an internal blob bound through the network is kept alive as well
+  real_t relu_buffer[18];
+  int relu_shape[] = { 1, 2, 3, 3 };
+  CHECK_SUCCESS(CaffeNetGetBlob(net, "r", &blob));
+  CHECK_SUCCESS(CaffeBlobReshape(blob, 4, relu_shape));
+  CHECK_SUCCESS(CaffeNetSetExternalData(net, "r", relu_buffer));
+  CHECK_SUCCESS(CaffeNetForward(net));
+  for (i = 0; i < 18; i++) {
+    CHECK(relu_buffer[i] == (i < 9 ? 0.f : 2.f * (i - 9)));
+  }
+  // tops of Flatten, Reshape and Slice are copied into, not pointed at the
+  // bottom
+  real_t flat_buffer[3][18];
+  const char *flat_names[] = { "f", "rs", "sl" };
+  for (k = 0; k < 3; k++) {
+    CHECK_SUCCESS(CaffeNetSetExternalData(net, flat_names[k],
+                                          flat_buffer[k]));
+    for (i = 0; i < 18; i++) {
+      flat_buffer[k][i] = -999.f;
+    }
+  }
+  CHECK_SUCCESS(CaffeNetForward(net));
+  for (k = 0; k < 3; k++) {
+    CHECK_SUCCESS(CaffeNetGetBlob(net, flat_names[k], &blob));
+    CHECK(CaffeBlobData(blob) == flat_buffer[k]);
+    for (i = 0; i < 18; i++) {
+      CHECK(flat_buffer[k][i] == (real_t)(i - 9));
+    }
+  }
+  // an internal blob asked from CaffeNetRun fails until it is marked, then
+  // it is neither released nor overwritten in place by the ReLU reading it
+  real_t run_input[18], power_buffer[18];
+  const real_t *run_input_data[] = { run_input };
+  real_t *power_data[] = { power_buffer };
+  int power_capacity = 18;
+  BlobHandle power;
+  CHECK_SUCCESS(CaffeNetGetBlob(net, "data", &blob));
+  CHECK_SUCCESS(CaffeNetGetBlob(net, "p", &power));
+  for (i = 0; i < 18; i++) {
+    run_input[i] = (real_t)(i - 9);
+    power_buffer[i] = -999.f;
+  }
+  CHECK(CaffeNetRun(net, 1, &blob, NULL, NULL, run_input_data,
+                    1, &power, &power_capacity, power_data) == -1);
+  CHECK_SUCCESS(CaffeNetMarkOutput(net, "p"));
+  CHECK_SUCCESS(CaffeNetRun(net, 1, &blob, NULL, NULL, run_input_data,
+                            1, &power, &power_capacity, power_data));
+  for (i = 0; i < 18; i++) {
+    CHECK(power_buffer[i] == 2.f * (i - 9));
+  }
+  CHECK_SUCCESS(CaffeNetDestroy(net));
+  for (k = 0; k < 2; k++) {
+    free(bound_expected[k]);
+    free(bound_buffer[k]);
+  }
 
   // should failed
   CHECK(CaffeNetCreate("no-such-prototxt", "no-such-caffemodel", &net) == -1);
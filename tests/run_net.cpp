@@ -167,12 +167,21 @@ struct ResNet : public TestFunctor {
 };
 
 void thread_test();
+void slice_test();
+void empty_rois_test();
+void deconv_params_test();
+void concat_outputs_test();
 
 int main(int argc, char *argv[]) {
   if (caffe::GPUAvailable()) {
     caffe::SetMode(caffe::GPU, 0);
   }
 
+  slice_test();
+  empty_rois_test();
+  deconv_params_test();
+  concat_outputs_test();
+
   Timer timer;
   Profiler *profiler = Profiler::Get();
   profiler->TurnON();
@@ -236,7 +245,7 @@ int main(int argc, char *argv[]) {
   net.CopyTrainedLayersFrom(*model_param);
 
   MemPoolState st = caffe::MemPoolGetState();
-  auto __Calc__ = [](int size) -> double {
+  auto __Calc__ = [](int64_t size) -> double {
     return std::round(static_cast<double>(size) / (1024 * 1024) * 100) / 100;
   };
   LOG(INFO) << "[CPU] Hold " << __Calc__(st.cpu_mem) << " M, Not Uses " << __Calc__(st.unused_cpu_mem) << " M";
@@ -265,3 +274,146 @@ void thread_test() {
   test.Forward();
   caffe::MemPoolClear();
 }
+
+// Slice tops seen by in-place layers must not write into the bottom
+void slice_test() {
+  const char *kNets[] = {
+    // a view of data would let the ReLU clobber the pinned input
+    "layer { name: 'data' type: 'Input' top: 'data'"
+    "  input_param { shape { dim: 1 dim: 8 dim: 4 dim: 4 } } }"
+    "layer { name: 'slice' type: 'Slice' bottom: 'data' top: 'a' top: 'b'"
+    "  slice_param { axis: 1 } }"
+    "layer { name: 'relu' type: 'ReLU' bottom: 'a' top: 'a' }"
+    "layer { name: 'd2' type: 'Power' bottom: 'data' top: 'd2' }",
+    // behind a Split the ReLU would clobber the sibling of the bottom
+    "layer { name: 'data' type: 'Input' top: 'data'"
+    "  input_param { shape { dim: 1 dim: 8 dim: 4 dim: 4 } } }"
+    "layer { name: 'x' type: 'Power' bottom: 'data' top: 'x' }"
+    "layer { name: 'split' type: 'Split' bottom: 'x' top: 'x1' top: 'x2' }"
+    "layer { name: 'slice' type: 'Slice' bottom: 'x1' top: 'a' top: 'b'"
+    "  slice_param { axis: 1 } }"
+    "layer { name: 'relu' type: 'ReLU' bottom: 'a' top: 'a' }"
+    "layer { name: 'd2' type: 'Power' bottom: 'x2' top: 'd2' }",
+  };
+  for (const char *prototxt : kNets) {
+    shared_ptr<NetParameter> param =
+        ReadTextNetParameterFromBuffer(prototxt, strlen(prototxt));
+    Net net(*param);
+    Blob *data = net.blob_by_name("data").get();
+    for (int i = 0; i < data->count(); i++) {
+      data->mutable_cpu_data()[i] = i % 2 == 0 ? -1 - i : i;
+    }
+    for (int iter = 0; iter < 2; iter++) {
+      net.Forward();
+      const Blob *d2 = net.blob_by_name("d2").get();
+      for (int i = 0; i < d2->count(); i++) {
+        CHECK_EQ(d2->cpu_data()[i], (i % 2 == 0 ? -1 - i : i));
+      }
+    }
+  }
+  LOG(INFO) << "Slice views checked";
+}
+
+// Proposal may drop every box, the layers reading its rois must cope
+void empty_rois_test() {
+  const char *prototxt =
+    "layer { name: 'input' type: 'Input' top: 'score' top: 'delta'"
+    "  top: 'info' top: 'feat' top: 'psfeat'"
+    "  input_param { shape { dim: 1 dim: 18 dim: 6 dim: 8 }"
+    "                shape { dim: 1 dim: 36 dim: 6 dim: 8 }"
+    "                shape { dim: 1 dim: 3 }"
+    "                shape { dim: 1 dim: 4 dim: 6 dim: 8 }"
+    "                shape { dim: 1 dim: 8 dim: 6 dim: 8 } } }"
+    "layer { name: 'proposal' type: 'Proposal' bottom: 'score'"
+    "  bottom: 'delta' bottom: 'info' top: 'rois'"
+    "  proposal_param { feat_stride: 16 min_size: 1000 } }"
+    "layer { name: 'pool' type: 'ROIPooling' bottom: 'feat' bottom: 'rois'"
+    "  top: 'pool' roi_pooling_param { pooled_h: 2 pooled_w: 2"
+    "  spatial_scale: 0.0625 } }"
+    "layer { name: 'pspool' type: 'PSROIPooling' bottom: 'psfeat'"
+    "  bottom: 'rois' top: 'pspool' psroi_pooling_param {"
+    "  spatial_scale: 0.0625 output_dim: 2 group_size: 2 } }"
+    // reading the pooled blobs as scores releases them after every forward
+    "layer { name: 'detection' type: 'DetectionOutput' bottom: 'rois'"
+    "  bottom: 'pool' bottom: 'info' top: 'detection'"
+    "  detection_output_param { background_label_id: -1 } }"
+    "layer { name: 'ps_detection' type: 'DetectionOutput' bottom: 'rois'"
+    "  bottom: 'pspool' bottom: 'info' top: 'ps_detection'"
+    "  detection_output_param { background_label_id: -1 } }";
+  shared_ptr<NetParameter> param =
+      ReadTextNetParameterFromBuffer(prototxt, strlen(prototxt));
+  Net net(*param);
+  for (auto blob : net.input_blobs()) {
+    std::fill(blob->mutable_cpu_data(),
+              blob->mutable_cpu_data() + blob->count(), 0.5f);
+  }
+  real_t *info = net.blob_by_name("info")->mutable_cpu_data();
+  info[0] = 96;
+  info[1] = 128;
+  info[2] = 1;
+  for (int iter = 0; iter < 2; iter++) {
+    net.Forward();
+    CHECK_EQ(net.blob_by_name("detection")->num(), 0);
+    CHECK_EQ(net.blob_by_name("ps_detection")->num(), 0);
+  }
+  LOG(INFO) << "Empty rois checked";
+}
+
+// weights written through params() after a forward must be used
+void deconv_params_test() {
+  const char *prototxt =
+    "layer { name: 'data' type: 'Input' top: 'data'"
+    "  input_param { shape { dim: 1 dim: 4 dim: 5 dim: 5 } } }"
+    "layer { name: 'up' type: 'Deconvolution' bottom: 'data' top: 'up'"
+    "  convolution_param { num_output: 16 kernel_size: 4 stride: 2 pad: 1"
+    "  bias_term: false } }";
+  shared_ptr<NetParameter> param =
+      ReadTextNetParameterFromBuffer(prototxt, strlen(prototxt));
+  Net net(*param);
+  Blob *data = net.blob_by_name("data").get();
+  for (int i = 0; i < data->count(); i++) {
+    data->mutable_cpu_data()[i] = i % 7 - 3;
+  }
+  Blob *weight = net.params()[0].get();
+  for (int i = 0; i < weight->count(); i++) {
+    weight->mutable_cpu_data()[i] = i % 5 - 2;
+  }
+  net.Forward();
+  const Blob *up = net.blob_by_name("up").get();
+  vector<real_t> first(up->cpu_data(), up->cpu_data() + up->count());
+  // doubled weights double the output
+  for (int i = 0; i < weight->count(); i++) {
+    weight->mutable_cpu_data()[i] *= 2;
+  }
+  net.Forward();
+  for (int i = 0; i < up->count(); i++) {
+    CHECK_EQ(up->cpu_data()[i], 2 * first[i]);
+  }
+  LOG(INFO) << "Deconvolution params checked";
+}
+
+// a Concat bottom requested by SetOutputs must not be a view of the output
+void concat_outputs_test() {
+  const char *prototxt =
+    "layer { name: 'data' type: 'Input' top: 'data'"
+    "  input_param { shape { dim: 1 dim: 2 dim: 3 dim: 3 } } }"
+    "layer { name: 'a' type: 'Power' bottom: 'data' top: 'a' }"
+    "layer { name: 'b' type: 'Power' bottom: 'data' top: 'b' }"
+    "layer { name: 'c' type: 'Concat' bottom: 'a' bottom: 'b' top: 'c' }"
+    "layer { name: 'relu' type: 'ReLU' bottom: 'c' top: 'c' }";
+  shared_ptr<NetParameter> param =
+      ReadTextNetParameterFromBuffer(prototxt, strlen(prototxt));
+  Net net(*param);
+  net.SetOutputs({"a", "c"});
+  Blob *data = net.blob_by_name("data").get();
+  std::fill(data->mutable_cpu_data(),
+            data->mutable_cpu_data() + data->count(), -2.f);
+  for (int iter = 0; iter < 3; iter++) {
+    net.Forward();
+    const Blob *a = net.blob_by_name("a").get();
+    for (int i = 0; i < a->count(); i++) {
+      CHECK_EQ(a->cpu_data()[i], -2);
+    }
+  }
+  LOG(INFO) << "Concat outputs checked";
+}
@@ -5,3 +5,7 @@ target_link_libraries(run_net caffe pthread)
 # c
 add_executable(run_net_c ${CMAKE_CURRENT_LIST_DIR}/run_net.c)
 target_link_libraries(run_net_c caffe pthread)
+
+# memory pool
+add_executable(mem_pool ${CMAKE_CURRENT_LIST_DIR}/mem_pool.cpp)
+target_link_libraries(mem_pool caffe pthread)
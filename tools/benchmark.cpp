@@ -1,34 +1,356 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
 #include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif  // __linux__
 
 #include <caffe/net.hpp>
 #include <caffe/profiler.hpp>
 
-int main(int argc, char *argv[]) {
-  CHECK_EQ(argc, 5) << "[Usage]: ./benchmark net.prototxt net.caffemodel iterations gpu_id";
-  std::string proto = argv[1];
-  std::string model = argv[2];
-  int iters = std::stoi(argv[3]);
-  int gpu_id = std::stoi(argv[4]);
-  LOG(INFO) << "net prototxt: " << proto;
-  LOG(INFO) << "net caffemodel: " << model;
-  LOG(INFO) << "net forward iterations: " << iters;
-  LOG(INFO) << "run on device " << gpu_id;
-
-  if (gpu_id >= 0 && caffe::GPUAvailable()) {
-    caffe::SetMode(caffe::GPU, gpu_id);
+#ifdef USE_OPENBLAS
+extern "C" void openblas_set_num_threads(int num_threads);
+#endif  // USE_OPENBLAS
+
+using namespace std;
+
+const char* kUsage =
+  "[Usage]: ./benchmark net.prototxt net.caffemodel iterations gpu_id\n"
+  "     or: ./benchmark --net net.prototxt [options]\n"
+  "  --net <path>          network prototxt\n"
+  "  --model <path>        network caffemodel, random weights if not given\n"
+  "  --iters <n>           timed forward iterations per shape (default 100)\n"
+  "  --warmup <n>          untimed forward iterations per shape (default 10)\n"
+  "  --gpu <id>            gpu device id, -1 for cpu (default -1)\n"
+  "  --threads <n>         blas threads, 0 keeps the library default (default 0)\n"
+  "  --affinity <c0,c1..>  pin the benchmark process to these cpu cores\n"
+  "  --input <name>        input blob to reshape (default first net input)\n"
+  "  --shape <n,c,h,w>     input shape to sweep, may be given multiple times\n"
+  "  --batch <b0,b1..>     batch sizes to sweep on the prototxt input shape\n"
+  "  --format <json|csv>   report format (default json)\n"
+  "  --output <path>       write report to file instead of stdout\n"
+  "  --profile <path>      dump per layer trace of the timed iterations\n";
+
+/*! \brief benchmark settings */
+struct Config {
+  string net;
+  string model;
+  int iters = 100;
+  int warmup = 10;
+  int gpu_id = -1;
+  int threads = 0;
+  vector<int> affinity;
+  string input;
+  vector<vector<int> > shapes;
+  vector<int> batches;
+  string format = "json";
+  string output;
+  string profile;
+};
+
+/*! \brief result of one shape */
+struct Result {
+  vector<int> shape;
+  double mean_ms, min_ms, max_ms;
+  double p50_ms, p90_ms, p99_ms;
+  double throughput;  // samples per second
+  double net_mem_mb;
+  double peak_cpu_mb, peak_gpu_mb;
+};
+
+static vector<int> ParseIntList(const string& str, char sep) {
+  vector<int> vals;
+  stringstream ss(str);
+  string item;
+  while (getline(ss, item, sep)) {
+    if (!item.empty()) vals.push_back(stoi(item));
   }
-  else {
-    gpu_id = -1;
+  return vals;
+}
+
+static string ShapeString(const vector<int>& shape, char sep) {
+  stringstream ss;
+  for (size_t i = 0; i < shape.size(); ++i) {
+    if (i) ss << sep;
+    ss << shape[i];
+  }
+  return ss.str();
+}
+
+/*! \brief quote a string for JSON, paths may hold quotes and backslashes */
+static string JSONString(const string& str) {
+  stringstream ss;
+  ss << '"';
+  for (char c : str) {
+    switch (c) {
+      case '"': ss << "\\\""; break;
+      case '\\': ss << "\\\\"; break;
+      case '\n': ss << "\\n"; break;
+      case '\r': ss << "\\r"; break;
+      case '\t': ss << "\\t"; break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char buf[8];
+          snprintf(buf, sizeof(buf), "\\u%04x", c);
+          ss << buf;
+        }
+        else {
+          ss << c;
+        }
+    }
+  }
+  ss << '"';
+  return ss.str();
+}
+
+static Config ParseArgs(int argc, char* argv[]) {
+  Config cfg;
+  // legacy positional form, kept for scripts
+  if (argc == 5 && string(argv[1]).compare(0, 2, "--") != 0) {
+    cfg.net = argv[1];
+    cfg.model = argv[2];
+    cfg.iters = stoi(argv[3]);
+    cfg.gpu_id = stoi(argv[4]);
+    cfg.warmup = 0;
+    cfg.profile = "./profile.json";
+    return cfg;
+  }
+  for (int i = 1; i < argc; ++i) {
+    string key = argv[i];
+    CHECK_LT(i + 1, argc) << "missing value for " << key << "\n" << kUsage;
+    string val = argv[++i];
+    if (key == "--net") cfg.net = val;
+    else if (key == "--model") cfg.model = val;
+    else if (key == "--iters") cfg.iters = stoi(val);
+    else if (key == "--warmup") cfg.warmup = stoi(val);
+    else if (key == "--gpu") cfg.gpu_id = stoi(val);
+    else if (key == "--threads") cfg.threads = stoi(val);
+    else if (key == "--affinity") cfg.affinity = ParseIntList(val, ',');
+    else if (key == "--input") cfg.input = val;
+    else if (key == "--shape") cfg.shapes.push_back(ParseIntList(val, ','));
+    else if (key == "--batch") cfg.batches = ParseIntList(val, ',');
+    else if (key == "--format") cfg.format = val;
+    else if (key == "--output") cfg.output = val;
+    else if (key == "--profile") cfg.profile = val;
+    else LOG(FATAL) << "unknown option " << key << "\n" << kUsage;
+  }
+  CHECK(!cfg.net.empty()) << kUsage;
+  CHECK_GT(cfg.iters, 0) << "iterations must be positive";
+  CHECK(cfg.format == "json" || cfg.format == "csv")
+      << "unsupported format " << cfg.format;
+  return cfg;
+}
+
+static void SetAffinity(const vector<int>& cores) {
+  if (cores.empty()) return;
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int core : cores) {
+    CPU_SET(core, &set);
   }
+  CHECK_EQ(sched_setaffinity(0, sizeof(set), &set), 0)
+      << "failed to set cpu affinity";
+#else
+  LOG(WARNING) << "cpu affinity is only supported on Linux, ignored";
+#endif  // __linux__
+}
+
+static void SetThreads(int threads) {
+  if (threads <= 0) return;
+#ifdef USE_OPENBLAS
+  openblas_set_num_threads(threads);
+#else
+  LOG(WARNING) << "thread count control needs OpenBLAS, ignored";
+#endif  // USE_OPENBLAS
+}
+
+static double Percentile(const vector<double>& sorted, double p) {
+  const double rank = p / 100. * (sorted.size() - 1);
+  const size_t lo = static_cast<size_t>(std::floor(rank));
+  const size_t hi = std::min(lo + 1, sorted.size() - 1);
+  return sorted[lo] + (rank - lo) * (sorted[hi] - sorted[lo]);
+}
+
+static double ToMB(int64_t bytes) {
+  return static_cast<double>(bytes) / (1024 * 1024);
+}
+
+static void FillRandom(caffe::Blob* blob, std::mt19937& gen) {
+  std::uniform_real_distribution<float> urd(-1.f, 1.f);
+  float* data = blob->mutable_cpu_data();
+  const int count = blob->count();
+  for (int i = 0; i < count; ++i) {
+    data[i] = urd(gen);
+  }
+}
 
-  caffe::Net net(proto);
-  net.CopyTrainedLayersFrom(model);
+static Result Run(caffe::Net& net, caffe::Blob* input,
+                  const vector<int>& shape, const Config& cfg) {
+  std::mt19937 gen(0);
+  input->Reshape(shape);
+  FillRandom(input, gen);
+  // release the pool so the high-water mark belongs to this shape only
+  caffe::MemPoolClear();
+  caffe::MemPoolState st = caffe::MemPoolGetState();
+  int64_t peak_cpu = st.cpu_mem;
+  int64_t peak_gpu = st.gpu_mem;
+  for (int i = 0; i < cfg.warmup; ++i) {
+    net.Forward();
+  }
+  // only the timed iterations go into the trace
   caffe::Profiler* profiler = caffe::Profiler::Get();
-  profiler->TurnON();
-  for (int i = 0; i < iters; i++) {
+  if (!cfg.profile.empty()) profiler->TurnON();
+  vector<double> times(cfg.iters);
+  for (int i = 0; i < cfg.iters; ++i) {
+    const uint64_t tic = profiler->Now();
     net.Forward();
+    const uint64_t toc = profiler->Now();
+    times[i] = static_cast<double>(toc - tic) / 1000;
+    st = caffe::MemPoolGetState();
+    peak_cpu = std::max(peak_cpu, st.cpu_mem);
+    peak_gpu = std::max(peak_gpu, st.gpu_mem);
+  }
+  if (!cfg.profile.empty()) profiler->TurnOFF();
+  Result res;
+  res.shape = shape;
+  std::sort(times.begin(), times.end());
+  double sum = 0;
+  for (double t : times) sum += t;
+  res.mean_ms = sum / times.size();
+  res.min_ms = times.front();
+  res.max_ms = times.back();
+  res.p50_ms = Percentile(times, 50);
+  res.p90_ms = Percentile(times, 90);
+  res.p99_ms = Percentile(times, 99);
+  const int batch = shape.empty() ? 1 : shape[0];
+  res.throughput = res.mean_ms > 0 ? batch * 1000. / res.mean_ms : 0;
+  res.net_mem_mb = net.MemSize();
+  res.peak_cpu_mb = ToMB(peak_cpu);
+  res.peak_gpu_mb = ToMB(peak_gpu);
+  LOG(INFO) << "shape [" << ShapeString(shape, ',') << "] p50 " << res.p50_ms
+            << " ms, p99 " << res.p99_ms << " ms, " << res.throughput
+            << " samples/s, pool peak " << res.peak_cpu_mb << " MB";
+  return res;
+}
+
+static void WriteJSON(std::ostream& os, const Config& cfg,
+                      const vector<Result>& results) {
+  os << "{" << endl;
+  os << "  \"net\": " << JSONString(cfg.net) << "," << endl;
+  os << "  \"device\": " << cfg.gpu_id << "," << endl;
+  os << "  \"threads\": " << cfg.threads << "," << endl;
+  os << "  \"warmup\": " << cfg.warmup << "," << endl;
+  os << "  \"iters\": " << cfg.iters << "," << endl;
+  os << "  \"results\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& r = results[i];
+    os << (i ? "," : "") << endl;
+    os << "    {" << endl;
+    os << "      \"shape\": [" << ShapeString(r.shape, ',') << "]," << endl;
+    os << "      \"mean_ms\": " << r.mean_ms << "," << endl;
+    os << "      \"min_ms\": " << r.min_ms << "," << endl;
+    os << "      \"p50_ms\": " << r.p50_ms << "," << endl;
+    os << "      \"p90_ms\": " << r.p90_ms << "," << endl;
+    os << "      \"p99_ms\": " << r.p99_ms << "," << endl;
+    os << "      \"max_ms\": " << r.max_ms << "," << endl;
+    os << "      \"throughput\": " << r.throughput << "," << endl;
+    os << "      \"net_mem_mb\": " << r.net_mem_mb << "," << endl;
+    os << "      \"peak_cpu_mb\": " << r.peak_cpu_mb << "," << endl;
+    os << "      \"peak_gpu_mb\": " << r.peak_gpu_mb << endl;
+    os << "    }";
+  }
+  os << endl << "  ]" << endl;
+  os << "}" << endl;
+}
+
+static void WriteCSV(std::ostream& os, const Config& cfg,
+                     const vector<Result>& results) {
+  os << "net,device,threads,shape,iters,mean_ms,min_ms,p50_ms,p90_ms,p99_ms,"
+     << "max_ms,throughput,net_mem_mb,peak_cpu_mb,peak_gpu_mb" << endl;
+  for (const Result& r : results) {
+    os << cfg.net << "," << cfg.gpu_id << "," << cfg.threads << ","
+       << ShapeString(r.shape, 'x') << "," << cfg.iters << ","
+       << r.mean_ms << "," << r.min_ms << "," << r.p50_ms << ","
+       << r.p90_ms << "," << r.p99_ms << "," << r.max_ms << ","
+       << r.throughput << "," << r.net_mem_mb << ","
+       << r.peak_cpu_mb << "," << r.peak_gpu_mb << endl;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  Config cfg = ParseArgs(argc, argv);
+  LOG(INFO) << "net prototxt: " << cfg.net;
+  LOG(INFO) << "net caffemodel: " << (cfg.model.empty() ? "(random)" : cfg.model);
+  LOG(INFO) << "net forward iterations: " << cfg.iters
+            << ", warmup: " << cfg.warmup;
+
+  if (cfg.gpu_id >= 0 && caffe::GPUAvailable()) {
+    caffe::SetMode(caffe::GPU, cfg.gpu_id);
+  }
+  else {
+    cfg.gpu_id = -1;
+  }
+  LOG(INFO) << "run on device " << cfg.gpu_id;
+  SetAffinity(cfg.affinity);
+  SetThreads(cfg.threads);
+
+  caffe::Net net(cfg.net);
+  if (!cfg.model.empty()) {
+    net.CopyTrainedLayersFrom(cfg.model);
+  }
+  else {
+    std::mt19937 gen(0);
+    for (auto& param : net.params()) {
+      FillRandom(param.get(), gen);
+    }
+  }
+  CHECK_GT(net.num_inputs(), 0) << "network has no input blob";
+  caffe::Blob* input = net.input_blobs()[0];
+  if (!cfg.input.empty()) {
+    CHECK(net.has_blob(cfg.input))
+        << "blob (" << cfg.input << ") is not availiable in Net";
+    input = net.blob_by_name(cfg.input).get();
+  }
+  // collect shapes to sweep
+  vector<vector<int> > shapes = cfg.shapes;
+  for (int batch : cfg.batches) {
+    vector<int> shape = input->shape();
+    CHECK(!shape.empty()) << "input blob has no shape to batch";
+    shape[0] = batch;
+    shapes.push_back(shape);
+  }
+  if (shapes.empty()) {
+    shapes.push_back(input->shape());
+  }
+
+  vector<Result> results;
+  for (const auto& shape : shapes) {
+    results.push_back(Run(net, input, shape, cfg));
+  }
+  if (!cfg.profile.empty()) {
+    caffe::Profiler::Get()->DumpProfile(cfg.profile.c_str());
+  }
+
+  std::ofstream fout;
+  if (!cfg.output.empty()) {
+    fout.open(cfg.output.c_str());
+    CHECK(fout.is_open()) << "failed to open " << cfg.output;
+  }
+  std::ostream& os = cfg.output.empty() ? std::cout : fout;
+  if (cfg.format == "json") {
+    WriteJSON(os, cfg, results);
+  }
+  else {
+    WriteCSV(os, cfg, results);
   }
-  profiler->TurnOFF();
-  profiler->DumpProfile("./profile.json");
   return 0;
 }
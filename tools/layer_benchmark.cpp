@@ -0,0 +1,295 @@
+// Microbenchmark of single layer implementations. Every case builds its layer
+// through LayerRegistry::CreateLayer with a synthetic LayerParameter and times
+// Forward on random data, shapes are taken from the example models.
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/text_format.h>
+#include <caffe/profiler.hpp>
+
+#include "../src/layer.hpp"
+#include "../src/layer_factory.hpp"
+#include "../src/util/im2col.hpp"
+
+using namespace std;
+using namespace caffe;
+
+const char* kUsage =
+  "[Usage]: ./layer_benchmark [options]\n"
+  "  --filter <str>   only run cases whose name contains str\n"
+  "  --iters <n>      timed iterations per case (default 50)\n"
+  "  --warmup <n>     untimed iterations per case (default 5)\n"
+  "  --list           list registered layer types and their case count\n";
+
+/*! \brief a layer under test with its bottom shapes */
+struct LayerCase {
+  string name;
+  string param;  // LayerParameter in text format
+  vector<vector<int> > bottoms;
+  int num_top;
+};
+
+/*! \brief a raw kernel under test, setup returns the function to time */
+struct KernelCase {
+  string name;
+  string shape;
+  std::function<std::function<void()>()> setup;
+};
+
+static vector<LayerCase> LayerCases() {
+  const vector<int> s64x112 = {1, 64, 112, 112};
+  const vector<int> s256x56 = {1, 256, 56, 56};
+  return {
+    // convolution
+    {"conv3x3_s1_64", "type: 'Convolution' convolution_param {"
+     " num_output: 64 kernel_size: 3 pad: 1 stride: 1 }", {{1, 64, 56, 56}}, 1},
+    {"conv7x7_s2_3", "type: 'Convolution' convolution_param {"
+     " num_output: 64 kernel_size: 7 pad: 3 stride: 2 }", {{1, 3, 224, 224}}, 1},
+    {"conv1x1_256_64", "type: 'Convolution' convolution_param {"
+     " num_output: 64 kernel_size: 1 }", {s256x56}, 1},
+    {"conv3x3_s2_128", "type: 'Convolution' convolution_param {"
+     " num_output: 128 kernel_size: 3 pad: 1 stride: 2 }", {{1, 64, 56, 56}}, 1},
+    {"conv3x3_dw_32", "type: 'Convolution' convolution_param {"
+     " num_output: 32 kernel_size: 3 pad: 1 group: 32 }", {{1, 32, 112, 112}}, 1},
+    {"conv4x4_landmark", "type: 'Convolution' convolution_param {"
+     " num_output: 20 kernel_size: 4 }", {{1, 1, 39, 39}}, 1},
+    {"conv3x3_s1_64_b8", "type: 'Convolution' convolution_param {"
+     " num_output: 64 kernel_size: 3 pad: 1 }", {{8, 64, 28, 28}}, 1},
+    // deconvolution
+    {"deconv4x4_s2_256", "type: 'Deconvolution' convolution_param {"
+     " num_output: 128 kernel_size: 4 pad: 1 stride: 2 }", {{1, 256, 16, 16}}, 1},
+    {"deconv2x2_s2_64", "type: 'Deconvolution' convolution_param {"
+     " num_output: 64 kernel_size: 2 stride: 2 }", {{1, 64, 32, 32}}, 1},
+    // inner product
+    {"ip_2048_1000", "type: 'InnerProduct' inner_product_param {"
+     " num_output: 1000 }", {{1, 2048}}, 1},
+    {"ip_4096_4096", "type: 'InnerProduct' inner_product_param {"
+     " num_output: 4096 }", {{1, 4096}}, 1},
+    {"ip_2048_1000_b16", "type: 'InnerProduct' inner_product_param {"
+     " num_output: 1000 }", {{16, 2048}}, 1},
+    // pooling
+    {"pool_max2x2_s2", "type: 'Pooling' pooling_param {"
+     " pool: MAX kernel_size: 2 stride: 2 }", {s64x112}, 1},
+    {"pool_max3x3_s2", "type: 'Pooling' pooling_param {"
+     " pool: MAX kernel_size: 3 stride: 2 }", {s64x112}, 1},
+    {"pool_max3x3_s1", "type: 'Pooling' pooling_param {"
+     " pool: MAX kernel_size: 3 stride: 1 pad: 1 }", {{1, 256, 28, 28}}, 1},
+    {"pool_ave3x3_s2", "type: 'Pooling' pooling_param {"
+     " pool: AVE kernel_size: 3 stride: 2 }", {s64x112}, 1},
+    {"pool_ave_global", "type: 'Pooling' pooling_param {"
+     " pool: AVE global_pooling: true }", {{1, 2048, 7, 7}}, 1},
+    {"pool_max_global", "type: 'Pooling' pooling_param {"
+     " pool: MAX global_pooling: true }", {{1, 2048, 7, 7}}, 1},
+    // normalization
+    {"lrn_across5", "type: 'LRN' lrn_param {"
+     " local_size: 5 alpha: 0.0001 beta: 0.75 }", {{1, 96, 55, 55}}, 1},
+    {"lrn_within3", "type: 'LRN' lrn_param {"
+     " local_size: 3 alpha: 0.0001 beta: 0.75 norm_region: WITHIN_CHANNEL }",
+     {{1, 32, 56, 56}}, 1},
+    {"batchnorm_64", "type: 'BatchNorm'", {s64x112}, 1},
+    {"scale_bias_64", "type: 'Scale' scale_param { bias_term: true }",
+     {s64x112}, 1},
+    {"bias_64", "type: 'Bias'", {s64x112}, 1},
+    {"mvn_64", "type: 'MVN'", {{1, 64, 56, 56}}, 1},
+    // softmax
+    {"softmax_1000", "type: 'Softmax'", {{1, 1000}}, 1},
+    {"softmax_c2_spatial", "type: 'Softmax'", {{1, 2, 240, 320}}, 1},
+    {"softmax_c21_spatial", "type: 'Softmax'", {{1, 21, 64, 64}}, 1},
+    // element wise
+    {"relu_64", "type: 'ReLU'", {s64x112}, 1},
+    {"prelu_64", "type: 'PReLU'", {s64x112}, 1},
+    {"elu_64", "type: 'ELU'", {s64x112}, 1},
+    {"sigmoid_64", "type: 'Sigmoid'", {s64x112}, 1},
+    {"tanh_64", "type: 'TanH'", {s64x112}, 1},
+    {"absval_64", "type: 'AbsVal'", {s64x112}, 1},
+    {"bnll_64", "type: 'BNLL'", {s64x112}, 1},
+    {"exp_64", "type: 'Exp'", {s64x112}, 1},
+    {"log_64", "type: 'Log'", {s64x112}, 1},
+    {"power_64", "type: 'Power' power_param { power: 2 scale: 0.5 shift: 1 }",
+     {s64x112}, 1},
+    {"threshold_64", "type: 'Threshold'", {s64x112}, 1},
+    {"dropout_64", "type: 'Dropout'", {s64x112}, 1},
+    {"eltwise_sum", "type: 'Eltwise'", {s256x56, s256x56}, 1},
+    {"eltwise_prod", "type: 'Eltwise' eltwise_param { operation: PROD }",
+     {s256x56, s256x56}, 1},
+    {"eltwise_max", "type: 'Eltwise' eltwise_param { operation: MAX }",
+     {s256x56, s256x56}, 1},
+    // data movement
+    {"concat_c2", "type: 'Concat'", {{1, 128, 28, 28}, {1, 128, 28, 28}}, 1},
+    {"concat_c4", "type: 'Concat'",
+     {{1, 64, 28, 28}, {1, 128, 28, 28}, {1, 32, 28, 28}, {1, 32, 28, 28}}, 1},
+    {"slice_c2", "type: 'Slice'", {s256x56}, 2},
+    {"split_2", "type: 'Split'", {s256x56}, 2},
+    {"crop_56", "type: 'Crop' crop_param { axis: 2 offset: 4 }",
+     {{1, 64, 64, 64}, {1, 64, 56, 56}}, 1},
+    {"flatten_2048", "type: 'Flatten'", {{1, 2048, 1, 1}}, 1},
+    {"reshape_64", "type: 'Reshape' reshape_param { shape { dim: 0 dim: -1 } }",
+     {s64x112}, 1},
+    {"tile_4", "type: 'Tile' tile_param { axis: 1 tiles: 4 }",
+     {{1, 64, 56, 56}}, 1},
+    {"argmax_1000", "type: 'ArgMax' argmax_param { top_k: 5 }", {{1, 1000}}, 1},
+    {"reduction_sum", "type: 'Reduction' reduction_param { axis: 1 }",
+     {{1, 64, 56, 56}}, 1},
+    {"spp_3", "type: 'SPP' spp_param { pyramid_height: 3 }",
+     {{1, 256, 13, 13}}, 1},
+  };
+}
+
+static void FillRandom(Blob* blob, std::mt19937& gen, real_t lo, real_t hi) {
+  std::uniform_real_distribution<real_t> urd(lo, hi);
+  real_t* data = blob->mutable_cpu_data();
+  for (int i = 0; i < blob->count(); ++i) {
+    data[i] = urd(gen);
+  }
+}
+
+static vector<KernelCase> KernelCases() {
+  struct Im2col {
+    int c, h, w, k, pad, stride;
+  };
+  const vector<Im2col> sets = {
+    {64, 56, 56, 3, 1, 1},
+    {64, 56, 56, 3, 1, 2},
+    {3, 224, 224, 7, 3, 2},
+    {1, 39, 39, 4, 0, 1},
+  };
+  vector<KernelCase> cases;
+  for (const Im2col& s : sets) {
+    stringstream ss;
+    ss << s.c << "x" << s.h << "x" << s.w << " k" << s.k << " s" << s.stride;
+    const int out_h = (s.h + 2 * s.pad - s.k) / s.stride + 1;
+    const int out_w = (s.w + 2 * s.pad - s.k) / s.stride + 1;
+    const int col_size = s.c * s.k * s.k * out_h * out_w;
+    auto im2col = [s, col_size]() -> std::function<void()> {
+      shared_ptr<vector<real_t> > im(new vector<real_t>(s.c * s.h * s.w, 1));
+      shared_ptr<vector<real_t> > col(new vector<real_t>(col_size));
+      return [s, im, col]() {
+        im2col_cpu(im->data(), s.c, s.h, s.w, s.k, s.k, s.pad, s.pad,
+                   s.stride, s.stride, 1, 1, col->data());
+      };
+    };
+    auto col2im = [s, col_size]() -> std::function<void()> {
+      shared_ptr<vector<real_t> > im(new vector<real_t>(s.c * s.h * s.w));
+      shared_ptr<vector<real_t> > col(new vector<real_t>(col_size, 1));
+      return [s, im, col]() {
+        col2im_cpu(col->data(), s.c, s.h, s.w, s.k, s.k, s.pad, s.pad,
+                   s.stride, s.stride, 1, 1, im->data());
+      };
+    };
+    cases.push_back({"im2col_cpu", ss.str(), im2col});
+    cases.push_back({"col2im_cpu", ss.str(), col2im});
+  }
+  return cases;
+}
+
+static void Report(const string& name, const string& type, const string& shape,
+                   vector<double>& times) {
+  std::sort(times.begin(), times.end());
+  double sum = 0;
+  for (double t : times) sum += t;
+  cout << name << "," << type << "," << shape << ","
+       << sum / times.size() << "," << times[times.size() / 2] << ","
+       << times.front() << "," << times.back() << endl;
+}
+
+static void Time(int warmup, int iters, const std::function<void()>& fn,
+                 vector<double>* times) {
+  Profiler* profiler = Profiler::Get();
+  for (int i = 0; i < warmup; ++i) {
+    fn();
+  }
+  times->resize(iters);
+  for (int i = 0; i < iters; ++i) {
+    const uint64_t tic = profiler->Now();
+    fn();
+    const uint64_t toc = profiler->Now();
+    (*times)[i] = static_cast<double>(toc - tic) / 1000;
+  }
+}
+
+static void RunLayerCase(const LayerCase& c, int warmup, int iters) {
+  LayerParameter param;
+  CHECK(google::protobuf::TextFormat::ParseFromString(c.param, &param))
+      << "bad layer parameter of case " << c.name;
+  param.set_name(c.name);
+  std::mt19937 gen(0);
+  vector<shared_ptr<Blob> > blobs;
+  vector<Blob*> bottom, top;
+  string shape;
+  for (const auto& s : c.bottoms) {
+    blobs.emplace_back(new Blob(s));
+    FillRandom(blobs.back().get(), gen, 0.1, 1);
+    bottom.push_back(blobs.back().get());
+    if (!shape.empty()) shape += " ";
+    shape += blobs.back()->shape_string();
+  }
+  for (int i = 0; i < c.num_top; ++i) {
+    blobs.emplace_back(new Blob);
+    top.push_back(blobs.back().get());
+  }
+  shared_ptr<Layer> layer = LayerRegistry::CreateLayer(param);
+  layer->SetUp(bottom, top);
+  // positive parameters keep variance like blobs away from zero
+  for (auto& blob : layer->blobs()) {
+    FillRandom(blob.get(), gen, 0.1, 1);
+  }
+  vector<double> times;
+  Time(warmup, iters, [&]() { layer->Forward(bottom, top); }, &times);
+  Report(c.name, param.type(), shape, times);
+}
+
+int main(int argc, char* argv[]) {
+  string filter;
+  int iters = 50;
+  int warmup = 5;
+  bool list = false;
+  for (int i = 1; i < argc; ++i) {
+    string key = argv[i];
+    if (key == "--list") {
+      list = true;
+      continue;
+    }
+    CHECK_LT(i + 1, argc) << "missing value for " << key << "\n" << kUsage;
+    string val = argv[++i];
+    if (key == "--filter") filter = val;
+    else if (key == "--iters") iters = std::stoi(val);
+    else if (key == "--warmup") warmup = std::stoi(val);
+    else LOG(FATAL) << "unknown option " << key << "\n" << kUsage;
+  }
+  CHECK_GT(iters, 0) << "iterations must be positive";
+
+  const vector<LayerCase> layer_cases = LayerCases();
+  if (list) {
+    for (const string& type : LayerRegistry::LayerTypeList()) {
+      int count = 0;
+      for (const LayerCase& c : layer_cases) {
+        LayerParameter param;
+        google::protobuf::TextFormat::ParseFromString(c.param, &param);
+        if (param.type() == type) ++count;
+      }
+      cout << type << "," << count << endl;
+    }
+    return 0;
+  }
+
+  cout << "case,type,shape,mean_ms,p50_ms,min_ms,max_ms" << endl;
+  for (const LayerCase& c : layer_cases) {
+    if (c.name.find(filter) == string::npos) continue;
+    RunLayerCase(c, warmup, iters);
+  }
+  for (const KernelCase& c : KernelCases()) {
+    if (c.name.find(filter) == string::npos) continue;
+    std::function<void()> fn = c.setup();
+    vector<double> times;
+    Time(warmup, iters, fn, &times);
+    Report(c.name, "kernel", c.shape, times);
+  }
+  return 0;
+}
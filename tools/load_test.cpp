@@ -0,0 +1,234 @@
+// Serving style load generator. Every worker thread owns a Net, optionally
+// sharing the weights of a master Net, and drives closed-loop (back to back)
+// or open-loop (Poisson arrival) traffic against it.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#include <sys/time.h>
+#endif  // _WIN32
+
+#include <caffe/net.hpp>
+
+using namespace std;
+
+const char* kUsage =
+  "[Usage]: ./load_test --net net.prototxt [options]\n"
+  "  --model <path>      network caffemodel, random weights if not given\n"
+  "  --threads <n>       concurrent callers (default 8)\n"
+  "  --mode <closed|open> back to back requests or Poisson arrivals (default closed)\n"
+  "  --qps <rate>        total arrival rate of open-loop mode (default 100)\n"
+  "  --duration <sec>    measured run time (default 10)\n"
+  "  --warmup <n>        untimed requests per thread (default 5)\n"
+  "  --share <0|1>       share weights of one master net between threads (default 1)\n";
+
+typedef std::chrono::steady_clock Clock;
+
+/*! \brief load test settings */
+struct Config {
+  string net;
+  string model;
+  int threads = 8;
+  bool open_loop = false;
+  double qps = 100;
+  double duration = 10;
+  int warmup = 5;
+  bool share = true;
+};
+
+/*! \brief what a worker thread reports back */
+struct WorkerStat {
+  vector<double> latency_ms;
+  caffe::MemPoolState pool;
+  double net_mem_mb = 0;
+};
+
+/*! \brief process cpu time in seconds */
+static double CPUTime() {
+#ifdef _WIN32
+  FILETIME create, exit, kernel, user;
+  GetProcessTimes(GetCurrentProcess(), &create, &exit, &kernel, &user);
+  auto to_sec = [](const FILETIME& ft) {
+    ULARGE_INTEGER v;
+    v.LowPart = ft.dwLowDateTime;
+    v.HighPart = ft.dwHighDateTime;
+    return static_cast<double>(v.QuadPart) * 1e-7;
+  };
+  return to_sec(kernel) + to_sec(user);
+#else
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 +
+         usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+#endif  // _WIN32
+}
+
+static double Percentile(const vector<double>& sorted, double p) {
+  if (sorted.empty()) return 0;
+  const double rank = p / 100. * (sorted.size() - 1);
+  const size_t lo = static_cast<size_t>(std::floor(rank));
+  const size_t hi = std::min(lo + 1, sorted.size() - 1);
+  return sorted[lo] + (rank - lo) * (sorted[hi] - sorted[lo]);
+}
+
+static void FillRandom(caffe::Blob* blob, std::mt19937& gen) {
+  std::uniform_real_distribution<float> urd(-1.f, 1.f);
+  float* data = blob->mutable_cpu_data();
+  for (int i = 0; i < blob->count(); ++i) {
+    data[i] = urd(gen);
+  }
+}
+
+static Config ParseArgs(int argc, char* argv[]) {
+  Config cfg;
+  for (int i = 1; i < argc; ++i) {
+    string key = argv[i];
+    CHECK_LT(i + 1, argc) << "missing value for " << key << "\n" << kUsage;
+    string val = argv[++i];
+    if (key == "--net") cfg.net = val;
+    else if (key == "--model") cfg.model = val;
+    else if (key == "--threads") cfg.threads = std::stoi(val);
+    else if (key == "--mode") cfg.open_loop = (val == "open");
+    else if (key == "--qps") cfg.qps = std::stod(val);
+    else if (key == "--duration") cfg.duration = std::stod(val);
+    else if (key == "--warmup") cfg.warmup = std::stoi(val);
+    else if (key == "--share") cfg.share = (std::stoi(val) != 0);
+    else LOG(FATAL) << "unknown option " << key << "\n" << kUsage;
+  }
+  CHECK(!cfg.net.empty()) << kUsage;
+  CHECK_GT(cfg.threads, 0) << "need at least one thread";
+  CHECK_GT(cfg.qps, 0) << "qps must be positive";
+  return cfg;
+}
+
+/*!
+ * \brief worker thread body, the Net is created inside the thread so its
+ *  memory comes from the thread local pool of this worker
+ */
+static void Worker(int tid, const Config& cfg, const caffe::Net* master,
+                   std::atomic<int>* ready, const Clock::time_point* start,
+                   std::atomic<bool>* go, WorkerStat* stat) {
+  caffe::Net net(cfg.net);
+  if (master != nullptr) {
+    const auto& src = master->params();
+    const auto& dst = net.params();
+    for (size_t i = 0; i < dst.size(); ++i) {
+      dst[i]->ShareData(*src[i]);
+    }
+  }
+  else if (!cfg.model.empty()) {
+    net.CopyTrainedLayersFrom(cfg.model);
+  }
+  std::mt19937 gen(tid);
+  for (caffe::Blob* input : net.input_blobs()) {
+    FillRandom(input, gen);
+  }
+  for (int i = 0; i < cfg.warmup; ++i) {
+    net.Forward();
+  }
+  ++(*ready);
+  while (!go->load()) {
+    std::this_thread::yield();
+  }
+
+  const Clock::time_point end = *start +
+      std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(cfg.duration));
+  std::exponential_distribution<double> arrival(cfg.qps / cfg.threads);
+  Clock::time_point next = *start;
+  while (true) {
+    Clock::time_point issue;
+    if (cfg.open_loop) {
+      // latency counts from the scheduled arrival, queueing included
+      next += std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(arrival(gen)));
+      if (next >= end) break;
+      std::this_thread::sleep_until(next);
+      issue = next;
+    }
+    else {
+      issue = Clock::now();
+      if (issue >= end) break;
+    }
+    net.Forward();
+    const double ms = std::chrono::duration<double, std::milli>(
+        Clock::now() - issue).count();
+    stat->latency_ms.push_back(ms);
+  }
+  stat->pool = caffe::MemPoolGetState();
+  stat->net_mem_mb = net.MemSize();
+}
+
+int main(int argc, char* argv[]) {
+  Config cfg = ParseArgs(argc, argv);
+  LOG(INFO) << "net prototxt: " << cfg.net;
+  LOG(INFO) << cfg.threads << " threads, "
+            << (cfg.open_loop ? "open-loop" : "closed-loop")
+            << (cfg.share ? ", shared weights" : ", private weights");
+
+  // master net holding the weights shared by all workers
+  std::unique_ptr<caffe::Net> master;
+  if (cfg.share) {
+    master.reset(new caffe::Net(cfg.net));
+    if (!cfg.model.empty()) {
+      master->CopyTrainedLayersFrom(cfg.model);
+    }
+  }
+
+  std::atomic<int> ready(0);
+  std::atomic<bool> go(false);
+  Clock::time_point start;
+  vector<WorkerStat> stats(cfg.threads);
+  vector<std::thread> workers;
+  for (int i = 0; i < cfg.threads; ++i) {
+    workers.emplace_back(Worker, i, std::cref(cfg), master.get(), &ready,
+                         &start, &go, &stats[i]);
+  }
+  while (ready.load() < cfg.threads) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  const double cpu_start = CPUTime();
+  start = Clock::now();
+  go.store(true);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  const double wall = std::chrono::duration<double>(
+      Clock::now() - start).count();
+  const double cpu = CPUTime() - cpu_start;
+
+  vector<double> all;
+  for (int i = 0; i < cfg.threads; ++i) {
+    const WorkerStat& s = stats[i];
+    all.insert(all.end(), s.latency_ms.begin(), s.latency_ms.end());
+    cout << "thread " << i << ": " << s.latency_ms.size() << " requests, "
+         << "pool cpu " << s.pool.cpu_mem / (1024. * 1024) << " MB "
+         << "(unused " << s.pool.unused_cpu_mem / (1024. * 1024) << " MB), "
+         << "pool gpu " << s.pool.gpu_mem / (1024. * 1024) << " MB, "
+         << "net " << s.net_mem_mb << " MB" << endl;
+  }
+  std::sort(all.begin(), all.end());
+  const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+  cout << "requests: " << all.size() << endl;
+  cout << "qps: " << all.size() / wall << endl;
+  cout << "latency ms: p50 " << Percentile(all, 50)
+       << ", p90 " << Percentile(all, 90)
+       << ", p99 " << Percentile(all, 99)
+       << ", p999 " << Percentile(all, 99.9)
+       << ", max " << (all.empty() ? 0 : all.back()) << endl;
+  cout << "cpu utilization: " << 100. * cpu / wall << "% of one core, "
+       << 100. * cpu / (wall * cores) << "% of " << cores << " cores" << endl;
+  return 0;
+}
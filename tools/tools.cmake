@@ -1,3 +1,17 @@
 # benchmark
 add_executable(benchmark ${CMAKE_CURRENT_LIST_DIR}/benchmark.cpp)
 target_link_libraries(benchmark caffe)
+if(MSVC OR ANDROID OR BLAS STREQUAL "openblas")
+  target_compile_definitions(benchmark PRIVATE USE_OPENBLAS)
+endif()
+
+# layer benchmark, uses internal classes which are only visible outside the
+# shared library on platforms that export all symbols
+if(NOT MSVC)
+  add_executable(layer_benchmark ${CMAKE_CURRENT_LIST_DIR}/layer_benchmark.cpp)
+  target_link_libraries(layer_benchmark caffe ${PROTOBUF_LIBRARY})
+endif()
+
+# load test
+add_executable(load_test ${CMAKE_CURRENT_LIST_DIR}/load_test.cpp)
+target_link_libraries(load_test caffe pthread)